@@ -0,0 +1,157 @@
+#define _GNU_SOURCE // For memrchr.
+
+#include <assert.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../include/chunk_reader.h"
+
+// Size of the generated input unless a file is given on the command
+// line.
+#define DEFAULT_INPUT_MEGABYTES 256
+
+// Times each reader is run per cache state; the best run is reported.
+#define REPEATS 3
+
+double now_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// Stand-in for parsing: sum every number in [DATA, DATA + LENGTH).
+uint64_t consume(const char* data, size_t length) {
+  const char* end    = data + length;
+  const char* cursor = data;
+  uint64_t sum       = 0;
+  while (cursor < end) {
+    if (*cursor >= '0' && *cursor <= '9') {
+      uint64_t num;
+      cursor = parse_uint64(cursor, end, &num);
+      sum += num;
+    } else {
+      cursor += 1;
+    }
+  }
+  return sum;
+}
+
+// Drop PATH from the page cache, as far as the kernel lets us.
+void evict(const char* path) {
+  int fd = open(path, O_RDONLY);
+  fdatasync(fd);
+  posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+  close(fd);
+}
+
+uint64_t read_with_stdio(const char* path) {
+  FILE* file   = fopen(path, "r");
+  char* buffer = malloc(CHUNK_READER_BUFFER_SIZE);
+
+  // Numbers may straddle fread boundaries, so keep the partial line.
+  uint64_t sum = 0;
+  size_t kept  = 0;
+  size_t got;
+  while ((got = fread(buffer + kept, 1, CHUNK_READER_BUFFER_SIZE - kept,
+                      file)) > 0) {
+    size_t length = kept + got;
+    char* newline = memrchr(buffer, '\n', length);
+    size_t whole  = newline == NULL ? 0 : newline - buffer + 1;
+    sum += consume(buffer, whole);
+    kept = length - whole;
+    memmove(buffer, buffer + whole, kept);
+  }
+  sum += consume(buffer, kept);
+
+  free(buffer);
+  fclose(file);
+  return sum;
+}
+
+uint64_t read_with_chunk_reader(const char* path,
+                                chunk_reader_backend backend) {
+  int fd               = open(path, O_RDONLY);
+  chunk_reader* reader = init_chunk_reader_with_backend(fd, backend);
+
+  uint64_t sum = 0;
+  size_t length;
+  const char* chunk;
+  while ((chunk = next_chunk(reader, &length)) != NULL) {
+    sum += consume(chunk, length);
+  }
+
+  free_chunk_reader(reader);
+  close(fd);
+  return sum;
+}
+
+uint64_t run_reader(const char* path, int reader) {
+  switch (reader) {
+  case 0:
+    return read_with_stdio(path);
+  case 1:
+    return read_with_chunk_reader(path, IO_URING);
+  default:
+    return read_with_chunk_reader(path, READER_THREAD);
+  }
+}
+
+int main(int argc, char** argv) {
+  char path[] = "/tmp/chunk_reader_bench_XXXXXX";
+  char* input = path;
+  if (argc > 1) {
+    input = argv[1];
+  } else {
+    // Day 01-shaped lines.
+    int fd           = mkstemp(path);
+    FILE* file       = fdopen(fd, "w");
+    size_t megabytes = DEFAULT_INPUT_MEGABYTES;
+    for (size_t i = 0; i < megabytes * 1024 * 1024 / 14; i += 1) {
+      fprintf(file, "%05zu   %05zu\n", (i * 7919) % 100000,
+              (i * 104729) % 100000);
+    }
+    fclose(file);
+  }
+
+  FILE* file = fopen(input, "r");
+  fseek(file, 0, SEEK_END);
+  double megabytes = ftell(file) / (1024.0 * 1024.0);
+  fclose(file);
+
+  // Cold numbers need a filesystem which honours POSIX_FADV_DONTNEED.
+  printf("Reading %.0f MB, MB/s (best of %d)\n", megabytes, REPEATS);
+  printf("%16s %12s %12s\n", "reader", "cold cache", "warm cache");
+
+  const char* names[] = {"stdio fread", "io_uring", "reader thread"};
+  uint64_t expected   = run_reader(input, 0);
+  for (int reader = 0; reader < 3; reader += 1) {
+    double best[2] = {0, 0};
+    for (int warm = 0; warm <= 1; warm += 1) {
+      for (int i = 0; i < REPEATS; i += 1) {
+        if (!warm) {
+          evict(input);
+        }
+
+        double start = now_ns();
+        uint64_t sum = run_reader(input, reader);
+        double rate  = megabytes / ((now_ns() - start) / 1e9);
+        assert(sum == expected);
+
+        if (rate > best[warm]) {
+          best[warm] = rate;
+        }
+      }
+    }
+    printf("%16s %12.0f %12.0f\n", names[reader], best[0], best[1]);
+  }
+
+  if (input == path) {
+    unlink(path);
+  }
+  return 0;
+}
@@ -0,0 +1,121 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../include/data.h"
+#include "../include/dyn_array.h"
+
+// Largest size benchmarked is 10^DEFAULT_MAX_EXPONENT unless another
+// exponent is given on the command line.
+#define DEFAULT_MAX_EXPONENT 7
+
+// Removing from the front shifts every element, so only this many
+// removes are timed.
+#define MAX_FRONT_REMOVES 1000
+
+// splitmix64, for reproducible values.
+uint64_t next_random(uint64_t* state) {
+  uint64_t z = (*state += 0x9e3779b97f4a7c15UL);
+  z          = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9UL;
+  z          = (z ^ (z >> 27)) * 0x94d049bb133111ebUL;
+  return z ^ (z >> 31);
+}
+
+double now_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+bool is_odd(const void* el, void* context) {
+  return (uint64_t)el % 2 == 1;
+}
+
+void bench_size(size_t size) {
+  uint64_t state = 42;
+  double start;
+
+  start          = now_ns();
+  dyn_array* arr = init_dyn_array(UINT64);
+  for (size_t i = 0; i < size; i += 1) {
+    push_onto_dyn_array(arr, (void*)next_random(&state));
+  }
+  double push = now_ns() - start;
+
+  // Memory per element, as grown by pushes.
+  double bytes_per_element =
+      (double)(sizeof(dyn_array) + arr->allocated * sizeof(uint64_t)) / size;
+
+  // Random indices, so that large arrays miss in cache.
+  start        = now_ns();
+  uint64_t sum = 0;
+  for (size_t i = 0; i < size; i += 1) {
+    sum += (uint64_t)get_element_of_dyn_array(arr, next_random(&state) % size);
+  }
+  double get = now_ns() - start;
+
+  start           = now_ns();
+  dyn_array* copy = copy_dyn_array(arr);
+  double copied   = now_ns() - start;
+
+  start = now_ns();
+  sort_dyn_array(copy);
+  double sort = now_ns() - start;
+
+  start      = now_ns();
+  char* text = pp_dyn_array(copy);
+  double pp  = now_ns() - start;
+  sum += text[0];
+  free(text);
+
+  start          = now_ns();
+  size_t removes = size < MAX_FRONT_REMOVES ? size : MAX_FRONT_REMOVES;
+  for (size_t i = 0; i < removes; i += 1) {
+    remove_element_of_dyn_array(copy, 0);
+  }
+  double remove_front = now_ns() - start;
+
+  start = now_ns();
+  for (size_t i = 0; i < removes; i += 1) {
+    swap_remove_element_of_dyn_array(copy, 0);
+  }
+  double swap_remove = now_ns() - start;
+
+  start = now_ns();
+  erase_if_in_dyn_array(arr, is_odd, NULL);
+  double erase_if = now_ns() - start;
+
+  // Printing the sum keeps the gets from being discarded.
+  printf("%12zu %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f "
+         "%10.1f %5lu\n",
+         size, push / size, get / size, copied / size, sort / size,
+         remove_front / removes, swap_remove / removes, erase_if / size,
+         pp / size, bytes_per_element, sum % 10);
+
+  free_dyn_array(copy);
+  free_dyn_array(arr);
+}
+
+int main(int argc, char** argv) {
+  int max_exponent = DEFAULT_MAX_EXPONENT;
+  if (argc > 1) {
+    max_exponent = atoi(argv[1]);
+  }
+
+  // Everything is per element but the removes, which are per remove
+  // from the front of the array.
+  printf("ns per operation\n");
+  printf("%12s %10s %10s %10s %10s %10s %10s %10s %10s %10s %5s\n", "size",
+         "push", "get", "copy", "sort", "remove", "swap rm", "erase if",
+         "pp", "bytes/el", "sum");
+
+  size_t size = 100;
+  for (int exponent = 2; exponent <= max_exponent; exponent += 1) {
+    bench_size(size);
+    size *= 10;
+  }
+
+  return 0;
+}
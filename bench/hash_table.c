@@ -0,0 +1,141 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../include/data.h"
+#include "../include/hash_table.h"
+
+// Largest size benchmarked is 10^DEFAULT_MAX_EXPONENT unless another
+// exponent is given on the command line.
+#define DEFAULT_MAX_EXPONENT 7
+
+// Keys of the colliding distribution are multiples of this, so only
+// 1 in COLLIDING_STRIDE of the table's ideal indices are ever used.
+#define COLLIDING_STRIDE 16
+
+typedef enum { SEQUENTIAL, RANDOM, COLLIDING } key_distribution;
+
+const char* distribution_names[] = {"sequential", "random", "colliding"};
+
+// splitmix64, for reproducible keys.
+uint64_t next_random(uint64_t* state) {
+  uint64_t z = (*state += 0x9e3779b97f4a7c15UL);
+  z          = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9UL;
+  z          = (z ^ (z >> 27)) * 0x94d049bb133111ebUL;
+  return z ^ (z >> 31);
+}
+
+double now_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// Fill KEYS with SIZE distinct non-zero keys of DISTRIBUTION, and MISSES
+// with SIZE keys of the same shape which are not among them.
+void make_keys(key_distribution distribution, size_t size, uint64_t* keys,
+               uint64_t* misses) {
+  uint64_t state = 42;
+  for (size_t i = 0; i < size; i += 1) {
+    switch (distribution) {
+    case SEQUENTIAL:
+      keys[i]   = i + 1;
+      misses[i] = size + i + 1;
+      break;
+    case RANDOM:
+      // The top bit tells keys from misses.
+      keys[i]   = next_random(&state) | (1UL << 63);
+      misses[i] = next_random(&state) & ~(1UL << 63);
+      break;
+    case COLLIDING:
+      keys[i]   = (i + 1) * COLLIDING_STRIDE;
+      misses[i] = (size + i + 1) * COLLIDING_STRIDE;
+      break;
+    }
+  }
+}
+
+void bench_size(key_distribution distribution, size_t size) {
+  uint64_t* keys   = malloc(size * sizeof(uint64_t));
+  uint64_t* misses = malloc(size * sizeof(uint64_t));
+  make_keys(distribution, size, keys, misses);
+  double start;
+
+  start             = now_ns();
+  hash_table* table = init_hash_table(UINT64, UINT64);
+  for (size_t i = 0; i < size; i += 1) {
+    set_entry_in_hash_table(table, (void*)keys[i], (void*)keys[i]);
+  }
+  double set = now_ns() - start;
+
+  // Memory per key, as grown by sets.
+  double bytes_per_key =
+      (double)(sizeof(hash_table) +
+               table->allocated * sizeof(hash_table_entry)) /
+      size;
+
+  start                = now_ns();
+  hash_table* presized = init_hash_table_with_capacity(UINT64, UINT64, size);
+  for (size_t i = 0; i < size; i += 1) {
+    set_entry_in_hash_table(presized, (void*)keys[i], (void*)keys[i]);
+  }
+  double set_presized = now_ns() - start;
+  free_hash_table(presized);
+
+  start        = now_ns();
+  uint64_t sum = 0;
+  for (size_t i = 0; i < size; i += 1) {
+    sum += (uint64_t)get_entry_in_hash_table(table, (void*)keys[i]);
+  }
+  double get_hit = now_ns() - start;
+
+  start = now_ns();
+  for (size_t i = 0; i < size; i += 1) {
+    sum += (uint64_t)get_entry_in_hash_table(table, (void*)misses[i]);
+  }
+  double get_miss = now_ns() - start;
+
+  // Removing every key also shrinks the table back down.
+  start = now_ns();
+  for (size_t i = 0; i < size; i += 1) {
+    remove_entry_in_hash_table(table, (void*)keys[i]);
+  }
+  double removed = now_ns() - start;
+
+  // Printing the sum keeps the gets from being discarded.
+  printf("%-10s %12zu %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f "
+         "%5lu\n",
+         distribution_names[distribution], size, set / size,
+         set_presized / size, (set - set_presized) / size, get_hit / size,
+         get_miss / size, removed / size, bytes_per_key, sum % 10);
+
+  free_hash_table(table);
+  free(misses);
+  free(keys);
+}
+
+int main(int argc, char** argv) {
+  int max_exponent = DEFAULT_MAX_EXPONENT;
+  if (argc > 1) {
+    max_exponent = atoi(argv[1]);
+  }
+
+  // Everything is per key. Resize is the cost of growing, the
+  // difference between sets into an empty and into a presized table.
+  printf("ns per operation\n");
+  printf("%-10s %12s %10s %10s %10s %10s %10s %10s %10s %5s\n", "keys", "size",
+         "set", "presized", "resize", "get hit", "get miss", "remove",
+         "bytes/key", "sum");
+
+  for (key_distribution d = SEQUENTIAL; d <= COLLIDING; d += 1) {
+    size_t size = 100;
+    for (int exponent = 2; exponent <= max_exponent; exponent += 1) {
+      bench_size(d, size);
+      size *= 10;
+    }
+  }
+
+  return 0;
+}
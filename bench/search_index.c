@@ -0,0 +1,144 @@
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../include/data.h"
+#include "../include/dyn_array.h"
+#include "../include/hash_table.h"
+#include "../include/search_index.h"
+
+// Queries timed per structure and size.
+#define NUM_QUERIES (1 << 20)
+
+// Largest size benchmarked is 10^DEFAULT_MAX_EXPONENT unless another
+// exponent is given on the command line. Sizes towards 10^9 need tens
+// of gigabytes, mostly for the hash table.
+#define DEFAULT_MAX_EXPONENT 7
+
+// splitmix64, for reproducible query streams.
+uint64_t next_random(uint64_t* state) {
+  uint64_t z = (*state += 0x9e3779b97f4a7c15UL);
+  z          = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9UL;
+  z          = (z ^ (z >> 27)) * 0x94d049bb133111ebUL;
+  return z ^ (z >> 31);
+}
+
+double now_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+int compare_keys(const void* v1, const void* v2) {
+  uint64_t a = *(uint64_t*)v1;
+  uint64_t b = *(uint64_t*)v2;
+  return (a > b) - (a < b);
+}
+
+void bench_size(size_t size) {
+  // Odd keys, so that roughly half of the uniformly drawn queries miss.
+  // Zero is never a key, which hash_table cannot store.
+  uint64_t* sorted = malloc(size * sizeof(uint64_t));
+  for (size_t i = 0; i < size; i += 1) {
+    sorted[i] = 2 * i + 1;
+  }
+
+  uint64_t state    = 42;
+  uint64_t* queries = malloc(NUM_QUERIES * sizeof(uint64_t));
+  for (size_t q = 0; q < NUM_QUERIES; q += 1) {
+    queries[q] = next_random(&state) % (2 * size + 2);
+  }
+  size_t* results = malloc(NUM_QUERIES * sizeof(size_t));
+
+  // The checksums keep the compiler from discarding the searches, and
+  // must agree between structures.
+  double start;
+
+  start               = now_ns();
+  search_index* index = init_search_index_from_uint64(sorted, size);
+  double index_build  = now_ns() - start;
+
+  start                 = now_ns();
+  size_t eytzinger_hits = 0;
+  for (size_t q = 0; q < NUM_QUERIES; q += 1) {
+    eytzinger_hits += contains_in_search_index(index, queries[q]);
+  }
+  double eytzinger = now_ns() - start;
+
+  start             = now_ns();
+  size_t single_sum = 0;
+  for (size_t q = 0; q < NUM_QUERIES; q += 1) {
+    single_sum += lower_bound_in_search_index(index, queries[q]);
+  }
+  double single = now_ns() - start;
+
+  start = now_ns();
+  lower_bound_batch_in_search_index(index, queries, NUM_QUERIES, results);
+  size_t batched_sum = 0;
+  for (size_t q = 0; q < NUM_QUERIES; q += 1) {
+    batched_sum += results[q];
+  }
+  double batched = now_ns() - start;
+
+  start               = now_ns();
+  size_t bsearch_hits = 0;
+  for (size_t q = 0; q < NUM_QUERIES; q += 1) {
+    bsearch_hits += bsearch(&queries[q], sorted, size, sizeof(uint64_t),
+                            compare_keys) != NULL;
+  }
+  double binary = now_ns() - start;
+
+  start             = now_ns();
+  hash_table* table = init_hash_table(UINT64, UINT64);
+  for (size_t i = 0; i < size; i += 1) {
+    set_entry_in_hash_table(table, (void*)sorted[i], (void*)1);
+  }
+  double table_build = now_ns() - start;
+
+  start             = now_ns();
+  size_t table_hits = 0;
+  for (size_t q = 0; q < NUM_QUERIES; q += 1) {
+    table_hits += get_entry_in_hash_table(table, (void*)queries[q]) != NULL;
+  }
+  double hashed = now_ns() - start;
+
+  assert(single_sum == batched_sum);
+  assert(eytzinger_hits == bsearch_hits);
+  assert(eytzinger_hits == table_hits);
+
+  printf("%12zu %12.1f %12.1f %12.1f %12.1f %12.1f %12.1f %12.1f\n", size,
+         index_build / size, eytzinger / NUM_QUERIES, single / NUM_QUERIES,
+         batched / NUM_QUERIES, binary / NUM_QUERIES, table_build / size,
+         hashed / NUM_QUERIES);
+
+  free_hash_table(table);
+  free_search_index(index);
+  free(results);
+  free(queries);
+  free(sorted);
+}
+
+int main(int argc, char** argv) {
+  int max_exponent = DEFAULT_MAX_EXPONENT;
+  if (argc > 1) {
+    max_exponent = atoi(argv[1]);
+  }
+
+  // Builds are per key, everything else per query. The eytzinger,
+  // bsearch and table get columns are membership checks, lower bound
+  // and batched are rank queries.
+  printf("ns per operation\n");
+  printf("%12s %12s %12s %12s %12s %12s %12s %12s\n", "size", "index build",
+         "eytzinger", "lower bound", "batched", "bsearch", "table build",
+         "table get");
+
+  size_t size = 1000;
+  for (int exponent = 3; exponent <= max_exponent; exponent += 1) {
+    bench_size(size);
+    size *= 10;
+  }
+
+  return 0;
+}
@@ -1,80 +1,448 @@
 #include <assert.h>
+#include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 
+#include "../include/chunk_reader.h"
 #include "../include/data.h"
 #include "../include/dyn_array.h"
 #include "../include/handler.h"
 #include "../include/hash_table.h"
+#include "../include/hyperloglog.h"
+#include "../include/input_cache.h"
+#include "../include/join.h"
+#include "../include/runner.h"
+#include "../include/thread_pool.h"
+#include "../include/timing.h"
 
-int solve(FILE* input_file) {
-  //// Parse input file into meaningful data.
-  dyn_array* lefts  = init_dyn_array(UINT64);
-  dyn_array* rights = init_dyn_array(UINT64);
+// Number of left elements whose matches one task sums up.
+#define SIMILARITY_GRAIN (1 << 16)
+
+// Columns with at most 1/COUNTING_SORT_RATIO as many distinct values as
+// elements are sorted by counting.
+#define COUNTING_SORT_RATIO 8
+
+typedef struct {
+  const uint64_t* lefts;  // The left column, sorted.
+  const uint64_t* rights; // The right column, sorted.
+  size_t length;          // Length of each column.
+} sorted_columns;
+
+// Sum the similarity of the runs of sorted lefts starting in [BEGIN,
+// END) into PARTIAL - the sorted_columns are the CONTEXT.
+void similarity_of_runs(void* context, size_t begin, size_t end,
+                        void* partial) {
+  sorted_columns* columns = context;
+
+  join_result join =
+      join_sorted_uint64_runs(columns->lefts, columns->length, columns->rights,
+                              columns->length, begin, end);
+  *(uint64_t*)partial = join.weighted_sum;
+}
+
+void add_similarities(void* result, const void* partial) {
+  *(uint64_t*)result += *(const uint64_t*)partial;
+}
+
+// Parse INPUT_FILE from byte OFFSET on into newly-alloced LEFTS and
+// RIGHTS columns. Return the number of bytes parsed, and set
+// WHOLE_LINES to whether they ended with a newline.
+uint64_t parse_columns(FILE* input_file, uint64_t offset, dyn_array** lefts,
+                       dyn_array** rights, bool* whole_lines) {
+  // Input is read ahead in large buffers while the lines already read
+  // are parsed. Numbers alternate between the left and right columns.
+  *lefts  = init_dyn_array(UINT64);
+  *rights = init_dyn_array(UINT64);
   uint64_t left;
-  uint64_t right;
-  while (fscanf(input_file, "%ld   %ld\n", &left, &right) == 2) {
-    push_onto_dyn_array(lefts, (void*)left);
-    push_onto_dyn_array(rights, (void*)right);
+  bool have_left = false;
+
+  uint64_t parsed = 0;
+  *whole_lines    = true;
+
+  chunk_reader* reader = init_chunk_reader_at(fileno(input_file), offset);
+  const char* input;
+  size_t input_length;
+  while ((input = next_chunk(reader, &input_length)) != NULL) {
+    parsed += input_length;
+    *whole_lines = input[input_length - 1] == '\n';
+
+    const char* end    = input + input_length;
+    const char* cursor = input;
+    while (cursor < end) {
+      if (*cursor < '0' || *cursor > '9') {
+        cursor += 1;
+        continue;
+      }
+
+      uint64_t num;
+      cursor = parse_uint64(cursor, end, &num);
+      if (!have_left) {
+        left      = num;
+        have_left = true;
+      } else {
+        push_onto_dyn_array(*lefts, (void*)left);
+        push_onto_dyn_array(*rights, (void*)num);
+        have_left = false;
+      }
+    }
   }
-  assert(lefts->occupied == rights->occupied);
+  free_chunk_reader(reader);
+  assert((*lefts)->occupied == (*rights)->occupied);
+  return parsed;
+}
 
-  //// Part 1.
-  dyn_array* sorted_lefts  = sorted_dyn_array(lefts);
-  dyn_array* sorted_rights = sorted_dyn_array(rights);
+// Return a sorted copy of the UINT64 COLUMN. A column with few distinct
+// values is sorted by counting each value in a hash table - presized
+// from an estimate of the distinct count, so it is never rehashed - and
+// sorting just the distinct values.
+dyn_array* sorted_column(dyn_array* column) {
+  size_t distinct = estimate_distinct_in_dyn_array(column);
+  if (distinct * COUNTING_SORT_RATIO > column->occupied) {
+    return sorted_dyn_array(column);
+  }
+
+  // Leave some slack for an underestimate. Zero cannot be a key, so
+  // its count is kept aside.
+  hash_table* counts =
+      init_hash_table_with_capacity(UINT64, UINT64, distinct + distinct / 16);
+  uint64_t zeroes  = 0;
+  uint64_t* values = (uint64_t*)column->data;
+  for (size_t i = 0; i < column->occupied; i += 1) {
+    if (values[i] == 0) {
+      zeroes += 1;
+    } else {
+      uint64_t count =
+          (uint64_t)get_entry_in_hash_table(counts, (void*)values[i]);
+      set_entry_in_hash_table(counts, (void*)values[i], (void*)(count + 1));
+    }
+  }
 
+  dyn_array* keys = init_dyn_array(UINT64);
+  reserve_dyn_array(keys, counts->occupied);
+  for (size_t i = 0; i < counts->allocated; i += 1) {
+    if (counts->entries[i].key != NULL) {
+      push_onto_dyn_array(keys, counts->entries[i].key);
+    }
+  }
+  sort_dyn_array(keys);
+
+  dyn_array* sorted = init_dyn_array(UINT64);
+  reserve_dyn_array(sorted, column->occupied);
+  for (uint64_t i = 0; i < zeroes; i += 1) {
+    push_onto_dyn_array(sorted, (void*)0);
+  }
+  for (size_t i = 0; i < keys->occupied; i += 1) {
+    void* key      = get_element_of_dyn_array(keys, i);
+    uint64_t count = (uint64_t)get_entry_in_hash_table(counts, key);
+    for (uint64_t j = 0; j < count; j += 1) {
+      push_onto_dyn_array(sorted, key);
+    }
+  }
+
+#ifdef HASH_TABLE_STATS
+  print_hash_table_stats(counts, "day01 counts");
+#endif
+  free_dyn_array(keys);
+  free_hash_table(counts);
+  return sorted;
+}
+
+// Return the sum of the distances between paired-up sorted COLUMNS.
+uint64_t distance_of_columns(sorted_columns* columns) {
   uint64_t distance = 0;
-  for (int i = 0; i < lefts->occupied; i += 1) {
-    uint64_t l = (uint64_t)get_element_of_dyn_array(sorted_lefts, i);
-    uint64_t r = (uint64_t)get_element_of_dyn_array(sorted_rights, i);
+  for (size_t i = 0; i < columns->length; i += 1) {
+    uint64_t l = columns->lefts[i];
+    uint64_t r = columns->rights[i];
     distance += (l > r) ? (l - r) : (r - l);
   }
-  printf("Answer 1: %ld\n", distance);
+  return distance;
+}
 
-  //// Part 2.
-  int similarity = 0;
+//// Kept state.
+// With caching on, the sorted columns are kept between runs along with
+// both answers. Each run which parses appended lines keeps them as a
+// run of their own - a block of the sorted lefts, the sorted rights and
+// the answers so far - appended to the state, so that it is neither
+// read back whole nor rewritten. The runs are merged lazily, as part 1
+// walks them, and only compacted into one once there are
+// MAX_KEPT_RUNS.
+#define MAX_KEPT_RUNS 8
 
-  hash_table* right_counts = init_hash_table(UINT64, UINT64);
+// Walks the values of one column of up to MAX_KEPT_RUNS sorted runs in
+// ascending order, as if they had been merged.
+typedef struct {
+  const uint64_t* heads[MAX_KEPT_RUNS]; // Next value of each run.
+  const uint64_t* ends[MAX_KEPT_RUNS];
+  size_t num_runs;
+} run_merger;
 
-  // Go through rights getting a lookup table of element counts.
-  for (int i = 0; i < rights->occupied; i += 1) {
-    void* v_el  = get_element_of_dyn_array(rights, i);
-    uint64_t el = (uint64_t)v_el;
+// Start MERGER on the lefts (or, if RIGHTS, the rights) of the
+// NUM_RUNS RUNS.
+void init_run_merger(run_merger* merger, sorted_columns* runs,
+                     size_t num_runs, bool rights) {
+  assert(num_runs <= MAX_KEPT_RUNS);
+  merger->num_runs = num_runs;
+  for (size_t i = 0; i < num_runs; i += 1) {
+    merger->heads[i] = rights ? runs[i].rights : runs[i].lefts;
+    merger->ends[i]  = merger->heads[i] + runs[i].length;
+  }
+}
 
-    void* current_entry = get_entry_in_hash_table(right_counts, (void*)el);
-    if (current_entry == NULL) {
-      set_entry_in_hash_table(right_counts, (void*)el, (void*)1);
-    } else {
-      uint64_t new_count = (uint64_t)current_entry + 1;
-      set_entry_in_hash_table(right_counts, (void*)el, (void*)new_count);
+// Return the smallest value MERGER has not yet returned - of which
+// there has to be one.
+uint64_t next_in_run_merger(run_merger* merger) {
+  size_t smallest = merger->num_runs;
+  for (size_t i = 0; i < merger->num_runs; i += 1) {
+    if (merger->heads[i] < merger->ends[i] &&
+        (smallest == merger->num_runs ||
+         *merger->heads[i] < *merger->heads[smallest])) {
+      smallest = i;
     }
   }
+  assert(smallest < merger->num_runs);
+  return *merger->heads[smallest]++;
+}
 
-  // Go through lefts checking the similarities and adding them up.
-  for (int i = 0; i < lefts->occupied; i += 1) {
-    void* v_el  = get_element_of_dyn_array(lefts, i);
-    uint64_t el = (uint64_t)v_el;
+// Return the total length of the NUM_RUNS RUNS.
+size_t length_of_runs(sorted_columns* runs, size_t num_runs) {
+  size_t length = 0;
+  for (size_t i = 0; i < num_runs; i += 1) {
+    length += runs[i].length;
+  }
+  return length;
+}
 
-    void* right_count = get_entry_in_hash_table(right_counts, (void*)el);
-    if (right_count != NULL) {
-      uint64_t count = (uint64_t)right_count;
-      similarity += count * el;
+// Return the sum of the distances between the paired-up columns the
+// NUM_RUNS RUNS merge into.
+uint64_t distance_of_runs(sorted_columns* runs, size_t num_runs) {
+  if (num_runs == 1) {
+    return distance_of_columns(&runs[0]);
+  }
+
+  run_merger lefts;
+  run_merger rights;
+  init_run_merger(&lefts, runs, num_runs, false);
+  init_run_merger(&rights, runs, num_runs, true);
+
+  uint64_t distance = 0;
+  size_t length     = length_of_runs(runs, num_runs);
+  for (size_t i = 0; i < length; i += 1) {
+    uint64_t l = next_in_run_merger(&lefts);
+    uint64_t r = next_in_run_merger(&rights);
+    distance += (l > r) ? (l - r) : (r - l);
+  }
+  return distance;
+}
+
+// Return a newly-alloced column merging the lefts (or, if RIGHTS, the
+// rights) of the NUM_RUNS RUNS.
+dyn_array* merged_column_of_runs(sorted_columns* runs, size_t num_runs,
+                                 bool rights) {
+  run_merger merger;
+  init_run_merger(&merger, runs, num_runs, rights);
+
+  size_t length     = length_of_runs(runs, num_runs);
+  dyn_array* merged = init_dyn_array(UINT64);
+  reserve_dyn_array(merged, length);
+  for (size_t i = 0; i < length; i += 1) {
+    push_onto_dyn_array(merged, (void*)next_in_run_merger(&merger));
+  }
+  return merged;
+}
+
+// Return how much appending the sorted ADDED columns to the NUM_OLD
+// sorted OLD runs adds to their similarity. Each side's counts of a
+// value are its run in a sorted column, so only the added values are
+// looked up - galloping through the old runs rather than walking them.
+uint64_t added_similarity(sorted_columns* old, size_t num_old,
+                          sorted_columns* added) {
+  uint64_t similarity =
+      join_sorted_uint64(added->lefts, added->length, added->rights,
+                         added->length)
+          .weighted_sum;
+  for (size_t i = 0; i < num_old; i += 1) {
+    similarity += join_sorted_uint64(added->lefts, added->length,
+                                     old[i].rights, old[i].length)
+                      .weighted_sum +
+                  join_sorted_uint64(old[i].lefts, old[i].length,
+                                     added->rights, added->length)
+                      .weighted_sum;
+  }
+  return similarity;
+}
+
+// Map the state kept from an earlier run over INPUT_PATH, or some
+// prefix of it, if there is one - and point RUNS at the runs it keeps,
+// setting NUM_RUNS.
+input_cache* load_state(const char* input_path, sorted_columns* runs,
+                        size_t* num_runs) {
+  *num_runs          = 0;
+  input_cache* state = load_input_cache_of_prefix(input_path, "day01", 3);
+  if (state == NULL) {
+    return NULL;
+  }
+
+  bool valid = state->num_blocks > 0 && state->num_blocks < MAX_KEPT_RUNS;
+  for (size_t b = 0; valid && b < state->num_blocks; b += 1) {
+    input_cache_block* block = &state->blocks[b];
+    if (block->lengths[0] != block->lengths[1] || block->lengths[2] != 2) {
+      valid = false;
     }
+    runs[b] = (sorted_columns){block->columns[0], block->columns[1],
+                               block->lengths[0]};
+  }
+  if (!valid) {
+    // Not something this solution wrote.
+    free_input_cache(state);
+    return NULL;
   }
-  printf("Answer 2: %d\n", similarity);
+  *num_runs = state->num_blocks;
+  return state;
+}
 
-  //// Cleanup.
-  free_hash_table(right_counts);
-  free_dyn_array(sorted_lefts);
-  free_dyn_array(sorted_rights);
+// Add a block of the sorted COLUMNS with the answers so far, DISTANCE
+// and SIMILARITY, to the state being written by WRITER.
+void add_run_to_state(input_cache_writer* writer, sorted_columns* columns,
+                      uint64_t distance, uint64_t similarity) {
+  uint64_t answers[2]      = {distance, similarity};
+  const uint64_t* block[3] = {columns->lefts, columns->rights, answers};
+  size_t lengths[3]        = {columns->length, columns->length, 2};
+  append_block_to_input_cache(writer, block, lengths);
+}
+
+// Keep the state of the NUM_RUNS sorted RUNS, with their DISTANCE and
+// SIMILARITY, for the first SIZE bytes of the input at INPUT_PATH. The
+// last run is the one just parsed - STATE, if not NULL, keeps the
+// others already.
+void write_state(const char* input_path, uint64_t size, input_cache* state,
+                 sorted_columns* runs, size_t num_runs, uint64_t distance,
+                 uint64_t similarity) {
+  input_cache_writer* writer = NULL;
+  if (state != NULL && num_runs < MAX_KEPT_RUNS) {
+    writer = init_input_cache_appender(state, input_path, "day01", size);
+  }
+  if (writer != NULL) {
+    add_run_to_state(writer, &runs[num_runs - 1], distance, similarity);
+    finish_input_cache(writer);
+    return;
+  }
+
+  writer = init_input_cache_writer_of_prefix(input_path, "day01", 3, size);
+  if (writer == NULL) {
+    return;
+  }
+  if (num_runs == 1) {
+    add_run_to_state(writer, &runs[0], distance, similarity);
+  } else {
+    // Compact every run into one.
+    dyn_array* lefts         = merged_column_of_runs(runs, num_runs, false);
+    dyn_array* rights        = merged_column_of_runs(runs, num_runs, true);
+    sorted_columns compacted = {(uint64_t*)lefts->data,
+                                (uint64_t*)rights->data, lefts->occupied};
+    add_run_to_state(writer, &compacted, distance, similarity);
+    free_dyn_array(lefts);
+    free_dyn_array(rights);
+  }
+  finish_input_cache(writer);
+}
+
+int solve(FILE* input_file) {
+  //// Parse input file into meaningful data.
+  // Neither answer depends on the order of the lines, so both columns
+  // are kept sorted - and as inputs only ever have lines appended, with
+  // state kept a run parses and sorts just the lines added since.
+  const char* input_path = current_input_file_path();
+
+  begin_phase("parse");
+  sorted_columns runs[MAX_KEPT_RUNS];
+  size_t num_kept;
+  input_cache* state = load_state(input_path, runs, &num_kept);
+  uint64_t kept_size = (state != NULL) ? state->header->input_size : 0;
+  const uint64_t* kept_answers =
+      (state != NULL) ? state->blocks[num_kept - 1].columns[2] : NULL;
+
+  dyn_array* lefts;
+  dyn_array* rights;
+  bool whole_lines;
+  begin_phase("read");
+  uint64_t parsed_size =
+      kept_size +
+      parse_columns(input_file, kept_size, &lefts, &rights, &whole_lines);
+  end_phase();
+
+  begin_phase("sort");
+  dyn_array* added_lefts  = sorted_column(lefts);
+  dyn_array* added_rights = sorted_column(rights);
   free_dyn_array(lefts);
   free_dyn_array(rights);
+  end_phase();
+  end_phase();
+
+  sorted_columns added = {(uint64_t*)added_lefts->data,
+                          (uint64_t*)added_rights->data,
+                          added_lefts->occupied};
+  size_t num_runs      = num_kept;
+  if (state == NULL || added.length > 0) {
+    runs[num_runs++] = added;
+  }
+
+#ifdef ALLOC_ACCOUNTING
+  print_alloc_report("parse");
+#endif
+
+  //// Part 1.
+  // Every added value shifts the pairing of those above it, so the kept
+  // runs are walked again, merged with the added one on the fly.
+  begin_phase("part 1");
+  uint64_t distance = (num_runs == num_kept)
+                          ? kept_answers[0]
+                          : distance_of_runs(runs, num_runs);
+  end_phase();
+  fprintf(current_output_file(), "Answer 1: %ld\n", distance);
+#ifdef ALLOC_ACCOUNTING
+  print_alloc_report("part 1");
+#endif
+
+  //// Part 2.
+  // Both columns are already sorted for part 1, so every left element
+  // matching some right elements is exactly one multiplicity join away -
+  // no need to build a table of counts. Runs of the lefts are joined
+  // independently across threads. Kept state only needs the matches
+  // the added values make.
+  begin_phase("part 2");
+  uint64_t similarity = 0;
+  if (state != NULL) {
+    similarity = kept_answers[1] + added_similarity(runs, num_kept, &added);
+  } else {
+    parallel_reduce(default_thread_pool(), 0, added.length, SIMILARITY_GRAIN,
+                    &similarity, sizeof(uint64_t), similarity_of_runs,
+                    add_similarities, &added);
+  }
+  end_phase();
+  fprintf(current_output_file(), "Answer 2: %ld\n", similarity);
+#ifdef ALLOC_ACCOUNTING
+  print_alloc_report("part 2");
+#endif
+
+  // A partial last line may yet be completed by what is appended, so
+  // only state ending on a whole line is kept.
+  if (num_runs > num_kept && whole_lines) {
+    begin_phase("write state");
+    write_state(input_path, parsed_size, state, runs, num_runs, distance,
+                similarity);
+    end_phase();
+  }
+
+  //// Cleanup.
+  if (state != NULL) {
+    free_input_cache(state);
+  }
+  free_dyn_array(added_lefts);
+  free_dyn_array(added_rights);
   fclose(input_file);
 
   return 0;
 }
 
-int main(int argc, char** argv) {
-  return input_file_handler(argv[1], *solve);
-}
+REGISTER_DAY(1, solve)
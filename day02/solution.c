@@ -3,11 +3,15 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
-#include <string.h>
 
+#include "../include/chunk_reader.h"
 #include "../include/data.h"
 #include "../include/dyn_array.h"
 #include "../include/handler.h"
+#include "../include/input_cache.h"
+#include "../include/runner.h"
+#include "../include/thread_pool.h"
+#include "../include/timing.h"
 
 bool is_safe(dyn_array* report) {
   assert(report->data_type == UINT64);
@@ -70,62 +74,347 @@ bool is_safe(dyn_array* report) {
   return is_safe;
 }
 
-int solve(FILE* input_file) {
-  //// Read input into list-of-lists.
-  // If an input requires more space, increase the line size.
-  char line[100];
-  dyn_array* reports = init_dyn_array(DYN_ARRAY);
-  while (fscanf(input_file, "%99[^\n]\n", line) == 1) {
-    dyn_array* line_arr = init_dyn_array(UINT64);
-
-    char* token;
-    char* rest_of_line = line;
-    while ((token = strtok_r(rest_of_line, " ", &rest_of_line))) {
-      uint64_t num = atoi(token);
-      push_onto_dyn_array(line_arr, (void*)num);
+// Whether REPORT would be safe with any single level removed.
+bool is_dampened_safe(dyn_array* report) {
+  bool dampened_is_safe = false;
+  for (size_t j = 0; j < report->occupied; j += 1) {
+    dyn_array* copy = copy_dyn_array(report);
+    remove_element_of_dyn_array(copy, j);
+    dampened_is_safe |= is_safe(copy);
+    free_dyn_array(copy);
+  }
+  return dampened_is_safe;
+}
+
+//// Batched evaluation.
+// Reports are judged REPORT_LANES at a time, one report per vector
+// lane, so that the per-level comparisons of is_safe become a handful
+// of compare masks. Build with -DSCALAR_REPORTS to judge every report
+// through is_safe and is_dampened_safe instead.
+#define REPORT_LANES 8
+
+typedef uint64_t level_lanes
+    __attribute__((vector_size(REPORT_LANES * sizeof(uint64_t))));
+typedef int64_t mask_lanes
+    __attribute__((vector_size(REPORT_LANES * sizeof(int64_t))));
+
+typedef struct {
+  size_t capacity;         // Longest report the scratch space fits.
+  level_lanes* levels;     // levels[p] holds level p of every lane.
+  mask_lanes* up_suffix;   // up_suffix[p]: all steps from level p rise.
+  mask_lanes* down_suffix; // down_suffix[p]: all steps from level p fall.
+} report_batch;
+
+report_batch* init_report_batch() {
+  return calloc(1, sizeof(report_batch));
+}
+
+void free_report_batch(report_batch* batch) {
+  free(batch->levels);
+  free(batch->up_suffix);
+  free(batch->down_suffix);
+  free(batch);
+}
+
+// Lanes where the step from level FROM to level TO rises by 1..3. The
+// comparison of the levels keeps a difference wrapping around 2^64 from
+// passing for a small one, as it does in is_safe.
+#define RISES_SAFELY(from, to) (((to) > (from)) & ((to) - (from) - 1 <= 2))
+
+// Lanes where the step from level FROM to level TO falls by 1..3.
+#define FALLS_SAFELY(from, to) (((from) > (to)) & ((from) - (to) - 1 <= 2))
+
+// Judge the NUM_REPORTS (at most REPORT_LANES) REPORTS, the levels of
+// each being LENGTHS long, storing whether each is safe as-is into
+// SAFE and whether it is safe with one level removed into
+// DAMPENED_SAFE. Agrees exactly with is_safe and is_dampened_safe.
+void evaluate_report_batch(report_batch* batch, const uint64_t** reports,
+                           const size_t* report_lengths, size_t num_reports,
+                           bool* safe, bool* dampened_safe) {
+  assert(num_reports <= REPORT_LANES);
+#ifdef SCALAR_REPORTS
+  for (size_t lane = 0; lane < num_reports; lane += 1) {
+    dyn_array* report = init_dyn_array(UINT64);
+    for (size_t p = 0; p < report_lengths[lane]; p += 1) {
+      push_onto_dyn_array(report, (void*)reports[lane][p]);
     }
-    push_onto_dyn_array(reports, (void*)line_arr);
+    safe[lane]          = is_safe(report);
+    dampened_safe[lane] = is_dampened_safe(report);
+    free_dyn_array(report);
+  }
+#else
+  // Transpose the reports into lanes, padding short ones with zeros -
+  // the padding is masked out by comparing positions to LENGTHS.
+  level_lanes lengths = {0};
+  size_t max_length   = 0;
+  for (size_t lane = 0; lane < num_reports; lane += 1) {
+    lengths[lane] = report_lengths[lane];
+    if (report_lengths[lane] > max_length) {
+      max_length = report_lengths[lane];
+    }
+  }
 
-    free_dyn_array(line_arr);
+  if (max_length + 1 > batch->capacity) {
+    batch->capacity    = 2 * (max_length + 1);
+    batch->levels      = realloc(batch->levels,
+                                 batch->capacity * sizeof(level_lanes));
+    batch->up_suffix   = realloc(batch->up_suffix,
+                                 batch->capacity * sizeof(mask_lanes));
+    batch->down_suffix = realloc(batch->down_suffix,
+                                 batch->capacity * sizeof(mask_lanes));
   }
 
-  //// Part 1.
-  size_t safe_reports_1 = 0;
-  for (size_t i = 0; i < reports->occupied; i += 1) {
-    dyn_array* report = get_element_of_dyn_array(reports, i);
-    assert(report->occupied != 0);
+  level_lanes* levels = batch->levels;
+  for (size_t p = 0; p < max_length; p += 1) {
+    for (size_t lane = 0; lane < REPORT_LANES; lane += 1) {
+      bool present    = lane < num_reports && p < report_lengths[lane];
+      levels[p][lane] = present ? reports[lane][p] : 0;
+    }
+  }
+
+  // Walking backwards, record for every position whether all of the
+  // steps from there to the end of the report rise (or fall) safely.
+  // Steps past the end of a report are vacuously safe.
+  mask_lanes no_lanes     = {0};
+  mask_lanes all_lanes    = ~no_lanes;
+  mask_lanes* up_suffix   = batch->up_suffix;
+  mask_lanes* down_suffix = batch->down_suffix;
+  up_suffix[max_length]   = all_lanes;
+  down_suffix[max_length] = all_lanes;
+  if (max_length > 0) {
+    up_suffix[max_length - 1]   = all_lanes;
+    down_suffix[max_length - 1] = all_lanes;
+  }
+  for (size_t p = max_length - 1; p-- > 0;) {
+    mask_lanes past_end = (p + 1 >= lengths);
+    mask_lanes rises    = RISES_SAFELY(levels[p], levels[p + 1]);
+    mask_lanes falls    = FALLS_SAFELY(levels[p], levels[p + 1]);
+
+    up_suffix[p]   = up_suffix[p + 1] & (rises | past_end);
+    down_suffix[p] = down_suffix[p + 1] & (falls | past_end);
+  }
+
+  // The report as-is.
+  mask_lanes safe_lanes = up_suffix[0] | down_suffix[0];
+
+  // The report with level k removed is the steps before k - 1, the
+  // step bridging k - 1 to k + 1, and the steps from k + 1 onwards.
+  // Walking forwards, keep whether all steps before k - 1 are safe.
+  mask_lanes up_prefix      = all_lanes;
+  mask_lanes down_prefix    = all_lanes;
+  mask_lanes dampened_lanes = no_lanes;
+  for (size_t k = 0; k < max_length; k += 1) {
+    if (k >= 2) {
+      up_prefix &= RISES_SAFELY(levels[k - 2], levels[k - 1]);
+      down_prefix &= FALLS_SAFELY(levels[k - 2], levels[k - 1]);
+    }
+
+    mask_lanes bridge_up   = all_lanes;
+    mask_lanes bridge_down = all_lanes;
+    if (k >= 1 && k + 1 < max_length) {
+      mask_lanes past_end = (k + 1 >= lengths);
 
-    if (is_safe(report)) {
-      safe_reports_1 += 1;
+      bridge_up   = RISES_SAFELY(levels[k - 1], levels[k + 1]) | past_end;
+      bridge_down = FALLS_SAFELY(levels[k - 1], levels[k + 1]) | past_end;
     }
+
+    mask_lanes removable = (k < lengths);
+    dampened_lanes |=
+        removable & ((up_prefix & bridge_up & up_suffix[k + 1]) |
+                     (down_prefix & bridge_down & down_suffix[k + 1]));
+  }
+
+  for (size_t lane = 0; lane < num_reports; lane += 1) {
+    safe[lane]          = safe_lanes[lane] != 0;
+    dampened_safe[lane] = dampened_lanes[lane] != 0;
   }
-  printf("Answer 1: %ld\n", safe_reports_1);
-
-  //// Part 2.
-  size_t safe_reports_2 = 0;
-  for (size_t i = 0; i < reports->occupied; i += 1) {
-    dyn_array* report = get_element_of_dyn_array(reports, i);
-
-    bool dampened_is_safe = false;
-    for (size_t j = 0; j < report->occupied; j += 1) {
-      dyn_array* copy = copy_dyn_array(report);
-      remove_element_of_dyn_array(copy, j);
-      dampened_is_safe |= is_safe(copy);
-      free_dyn_array(copy);
+#endif
+}
+
+// Number of reports one task judges - a multiple of REPORT_LANES.
+#define REPORT_GRAIN (512 * REPORT_LANES)
+
+// Reports are read and judged a chunk at a time, a chunk being closed
+// once it holds this many levels, so memory use is bounded by the chunk
+// and the longest line rather than by the input.
+#define REPORT_CHUNK_LEVELS (1 << 20)
+
+typedef struct {
+  const uint64_t* levels;      // Levels of every report, back to back.
+  const uint64_t* report_ends; // One past the last level of each report.
+  size_t num_reports;
+} report_chunk;
+
+typedef struct {
+  size_t safe;          // Reports safe as-is.
+  size_t dampened_safe; // Reports safe with a level removed.
+} safe_counts;
+
+// Count the safe reports among those of the report_chunk CONTEXT at
+// [BEGIN, END) into PARTIAL.
+void count_safe_reports(void* context, size_t begin, size_t end,
+                        void* partial) {
+  report_chunk* chunk         = context;
+  const uint64_t* levels      = chunk->levels;
+  const uint64_t* report_ends = chunk->report_ends;
+
+  safe_counts* counts   = partial;
+  counts->safe          = 0;
+  counts->dampened_safe = 0;
+
+  report_batch* batch = init_report_batch();
+  for (size_t i = begin; i < end; i += REPORT_LANES) {
+    const uint64_t* lanes[REPORT_LANES];
+    size_t lengths[REPORT_LANES];
+    size_t num_lanes = 0;
+    while (num_lanes < REPORT_LANES && i + num_lanes < end) {
+      size_t report      = i + num_lanes;
+      size_t start       = report == 0 ? 0 : report_ends[report - 1];
+      lanes[num_lanes]   = levels + start;
+      lengths[num_lanes] = report_ends[report] - start;
+      num_lanes += 1;
+    }
+
+    bool safe[REPORT_LANES];
+    bool dampened_safe[REPORT_LANES];
+    evaluate_report_batch(batch, lanes, lengths, num_lanes, safe,
+                          dampened_safe);
+    for (size_t lane = 0; lane < num_lanes; lane += 1) {
+      counts->safe += safe[lane];
+      counts->dampened_safe += dampened_safe[lane];
+    }
+  }
+  free_report_batch(batch);
+}
+
+void add_safe_counts(void* result, const void* partial) {
+  safe_counts* total        = result;
+  const safe_counts* counts = partial;
+  total->safe += counts->safe;
+  total->dampened_safe += counts->dampened_safe;
+}
+
+// Judge every report of CHUNK, adding the results to COUNTS.
+void count_safe_reports_in_chunk(report_chunk* chunk, safe_counts* counts) {
+  // Each batch of reports is judged both as-is and dampened at once,
+  // with groups of batches spread across threads.
+  begin_phase("evaluate");
+  parallel_reduce(default_thread_pool(), 0, chunk->num_reports, REPORT_GRAIN,
+                  counts, sizeof(safe_counts), count_safe_reports,
+                  add_safe_counts, chunk);
+  end_phase();
+}
+
+// Close the report being parsed into LEVELS and REPORT_ENDS - unless
+// it has no levels, as blank lines are not reports.
+void end_report(dyn_array* levels, dyn_array* report_ends) {
+  uint64_t last_end = 0;
+  if (report_ends->occupied > 0) {
+    last_end = (uint64_t)get_element_of_dyn_array(report_ends,
+                                                  report_ends->occupied - 1);
+  }
+  if (levels->occupied > last_end) {
+    push_onto_dyn_array(report_ends, (void*)levels->occupied);
+  }
+}
+
+// Judge the reports parsed into LEVELS and REPORT_ENDS, adding the
+// results to COUNTS, and append them to the cache being written by
+// WRITER (if not NULL).
+void count_safe_parsed_reports(dyn_array* levels, dyn_array* report_ends,
+                               safe_counts* counts,
+                               input_cache_writer* writer) {
+  report_chunk chunk;
+  chunk.levels      = (uint64_t*)levels->data;
+  chunk.report_ends = (uint64_t*)report_ends->data;
+  chunk.num_reports = report_ends->occupied;
+  count_safe_reports_in_chunk(&chunk, counts);
+
+  if (writer != NULL) {
+    const uint64_t* block[2] = {chunk.levels, chunk.report_ends};
+    size_t lengths[2]        = {levels->occupied, report_ends->occupied};
+    append_block_to_input_cache(writer, block, lengths);
+  }
+}
+
+int solve(FILE* input_file) {
+  //// Parts 1 and 2.
+  begin_phase("reports");
+  safe_counts counts     = {0, 0};
+  const char* input_path = current_input_file_path();
+
+  // A cache of this input holds one block of levels and report ends
+  // per chunk, ready to be judged as they are.
+  input_cache* cache = load_input_cache(input_path, "day02", 2);
+  if (cache != NULL) {
+    for (size_t b = 0; b < cache->num_blocks; b += 1) {
+      report_chunk chunk;
+      chunk.levels      = cache->blocks[b].columns[0];
+      chunk.report_ends = cache->blocks[b].columns[1];
+      chunk.num_reports = cache->blocks[b].lengths[1];
+      count_safe_reports_in_chunk(&chunk, &counts);
     }
-    if (dampened_is_safe) {
-      safe_reports_2 += 1;
+    free_input_cache(cache);
+  } else {
+    // Stream the input - every report is judged on its own, so only the
+    // current chunk of them is ever held in memory. Input is read ahead
+    // in large buffers while the reports already read are parsed.
+    input_cache_writer* writer =
+        init_input_cache_writer(input_path, "day02", 2);
+
+    dyn_array* levels      = init_dyn_array(UINT64);
+    dyn_array* report_ends = init_dyn_array(UINT64);
+    reserve_dyn_array(levels, REPORT_CHUNK_LEVELS);
+
+    chunk_reader* reader = init_chunk_reader(fileno(input_file));
+    const char* input;
+    size_t input_length;
+    while ((input = next_chunk(reader, &input_length)) != NULL) {
+      const char* end    = input + input_length;
+      const char* cursor = input;
+      while (cursor < end) {
+        if (*cursor >= '0' && *cursor <= '9') {
+          uint64_t num;
+          cursor = parse_uint64(cursor, end, &num);
+          push_onto_dyn_array(levels, (void*)num);
+          continue;
+        }
+
+        if (*cursor == '\n') {
+          end_report(levels, report_ends);
+
+          if (levels->occupied >= REPORT_CHUNK_LEVELS) {
+            count_safe_parsed_reports(levels, report_ends, &counts, writer);
+            // Keep the allocations for the next chunk.
+            erase_range_of_dyn_array(levels, 0, levels->occupied);
+            erase_range_of_dyn_array(report_ends, 0, report_ends->occupied);
+          }
+        }
+        cursor += 1;
+      }
+    }
+    // The last line may lack its newline.
+    end_report(levels, report_ends);
+    count_safe_parsed_reports(levels, report_ends, &counts, writer);
+
+    free_chunk_reader(reader);
+    free_dyn_array(levels);
+    free_dyn_array(report_ends);
+    if (writer != NULL) {
+      finish_input_cache(writer);
     }
   }
+  end_phase();
 
-  printf("Answer 2: %ld\n", safe_reports_2);
+  fprintf(current_output_file(), "Answer 1: %ld\n", counts.safe);
+  fprintf(current_output_file(), "Answer 2: %ld\n", counts.dampened_safe);
+#ifdef ALLOC_ACCOUNTING
+  print_alloc_report("parts 1 and 2");
+#endif
 
   //// Cleanup.
-  free_dyn_array(reports);
   fclose(input_file);
   return 0;
 }
 
-int main(int argc, char** argv) {
-  return input_file_handler(argv[1], *solve);
-}
+REGISTER_DAY(2, solve)
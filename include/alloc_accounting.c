@@ -0,0 +1,373 @@
+// The wrappers themselves call the real allocator.
+#define ALLOC_ACCOUNTING_IMPLEMENTATION
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "./alloc_accounting.h"
+
+// Call sites are kept in a fixed table - the library has far fewer. Any
+// past that are lumped into one extra site.
+#define MAX_SITES 1024
+#define MAX_SUBSYSTEMS 32
+#define MAX_SUBSYSTEM_NAME 32
+
+// Number of leaked allocations listed one by one.
+#define MAX_LISTED_LEAKS 20
+
+typedef struct {
+  const char* file; // NULL if this site is unused.
+  const char* func;
+  int line;
+  size_t subsystem; // Index into subsystems.
+  alloc_counters counters;
+} alloc_site;
+
+typedef struct {
+  char name[MAX_SUBSYSTEM_NAME];
+  alloc_counters counters;
+} alloc_subsystem;
+
+typedef struct {
+  void* ptr; // NULL if this slot is empty.
+  size_t size;
+  size_t site; // Index into sites.
+} live_alloc;
+
+static pthread_mutex_t lock           = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t leak_check_once = PTHREAD_ONCE_INIT;
+
+static alloc_counters totals;
+static alloc_site sites[MAX_SITES + 1];
+static alloc_subsystem subsystems[MAX_SUBSYSTEMS];
+static size_t num_subsystems;
+
+// Every live allocation, by pointer, in an open-addressed table.
+static live_alloc* live;
+static size_t live_allocated;
+static size_t live_occupied;
+
+bool alloc_accounting_enabled() {
+#ifdef ALLOC_ACCOUNTING
+  return true;
+#else
+  return false;
+#endif
+}
+
+static void check_leaks_at_exit() {
+  if (report_alloc_leaks(stderr) > 0) {
+    fflush(NULL);
+    _exit(EXIT_FAILURE);
+  }
+}
+
+static void init_leak_check() {
+  const char* leak_check = getenv("AOC_LEAK_CHECK");
+  if (leak_check != NULL && strcmp(leak_check, "1") == 0) {
+    atexit(check_leaks_at_exit);
+  }
+}
+
+// Return the index of the subsystem an allocation in FILE belongs to -
+// the file's name, without directories or extension. Call with the
+// lock held.
+static size_t subsystem_of(const char* file) {
+  const char* base = strrchr(file, '/');
+  base             = base == NULL ? file : base + 1;
+  size_t length    = strcspn(base, ".");
+  if (length >= MAX_SUBSYSTEM_NAME) {
+    length = MAX_SUBSYSTEM_NAME - 1;
+  }
+  char name[MAX_SUBSYSTEM_NAME];
+  memcpy(name, base, length);
+  name[length] = '\0';
+
+  for (size_t i = 0; i < num_subsystems; i += 1) {
+    if (strcmp(subsystems[i].name, name) == 0) {
+      return i;
+    }
+  }
+  if (num_subsystems == MAX_SUBSYSTEMS) {
+    return MAX_SUBSYSTEMS - 1;
+  }
+  strcpy(subsystems[num_subsystems].name, name);
+  return num_subsystems++;
+}
+
+// Return the index of the call site FILE:LINE in FUNC. Call with the
+// lock held.
+static size_t site_of(const char* file, const char* func, int line) {
+  // The file names are string literals, so their addresses identify
+  // them.
+  size_t ideal = ((uintptr_t)file * 31 + line) % MAX_SITES;
+  for (size_t probe = 0; probe < MAX_SITES; probe += 1) {
+    size_t idx = (ideal + probe) % MAX_SITES;
+    if (sites[idx].file == NULL) {
+      sites[idx].file      = file;
+      sites[idx].func      = func;
+      sites[idx].line      = line;
+      sites[idx].subsystem = subsystem_of(file);
+      return idx;
+    }
+    if (sites[idx].file == file && sites[idx].line == line) {
+      return idx;
+    }
+  }
+
+  if (sites[MAX_SITES].file == NULL) {
+    sites[MAX_SITES].file      = "(other sites)";
+    sites[MAX_SITES].func      = "";
+    sites[MAX_SITES].subsystem = subsystem_of("other");
+  }
+  return MAX_SITES;
+}
+
+static size_t live_index(void* ptr) {
+  uint64_t hash = (uintptr_t)ptr >> 4;
+  hash *= 0x9e3779b97f4a7c15UL;
+  return hash & (live_allocated - 1);
+}
+
+// Put the allocation ALLOC into the live table, which has room.
+static void insert_live(live_alloc alloc) {
+  size_t idx = live_index(alloc.ptr);
+  while (live[idx].ptr != NULL) {
+    idx = (idx + 1) & (live_allocated - 1);
+  }
+  live[idx] = alloc;
+  live_occupied += 1;
+}
+
+// Take the allocation of PTR out of the live table into ALLOC - return
+// whether it was there.
+static bool remove_live(void* ptr, live_alloc* alloc) {
+  if (live_allocated == 0) {
+    return false;
+  }
+
+  size_t idx = live_index(ptr);
+  while (live[idx].ptr != ptr) {
+    if (live[idx].ptr == NULL) {
+      return false;
+    }
+    idx = (idx + 1) & (live_allocated - 1);
+  }
+  *alloc = live[idx];
+  live_occupied -= 1;
+
+  // Shift back any later entries which could not be at their ideal
+  // slot, so that probes stay unbroken.
+  size_t empty = idx;
+  size_t next  = (idx + 1) & (live_allocated - 1);
+  while (live[next].ptr != NULL) {
+    size_t ideal = live_index(live[next].ptr);
+    if (((next - ideal) & (live_allocated - 1)) >=
+        ((next - empty) & (live_allocated - 1))) {
+      live[empty] = live[next];
+      empty       = next;
+    }
+    next = (next + 1) & (live_allocated - 1);
+  }
+  live[empty].ptr = NULL;
+  return true;
+}
+
+static void add_bytes(alloc_counters* counters, size_t size) {
+  counters->live_bytes += size;
+  counters->total_bytes += size;
+  counters->calls += 1;
+  if (counters->live_bytes > counters->peak_bytes) {
+    counters->peak_bytes = counters->live_bytes;
+  }
+}
+
+static void remove_bytes(alloc_counters* counters, size_t size) {
+  counters->live_bytes -= size;
+  counters->frees += 1;
+}
+
+// Record the allocation of SIZE bytes at PTR by the given call site.
+static void track(void* ptr, size_t size, const char* file, const char* func,
+                  int line) {
+  pthread_once(&leak_check_once, init_leak_check);
+  pthread_mutex_lock(&lock);
+
+  if (2 * (live_occupied + 1) > live_allocated) {
+    live_alloc* old      = live;
+    size_t old_allocated = live_allocated;
+    live_allocated       = old_allocated == 0 ? 1024 : 2 * old_allocated;
+    live                 = calloc(live_allocated, sizeof(live_alloc));
+    live_occupied        = 0;
+    for (size_t i = 0; i < old_allocated; i += 1) {
+      if (old[i].ptr != NULL) {
+        insert_live(old[i]);
+      }
+    }
+    free(old);
+  }
+
+  size_t site = site_of(file, func, line);
+  insert_live((live_alloc){ptr, size, site});
+  add_bytes(&totals, size);
+  add_bytes(&sites[site].counters, size);
+  add_bytes(&subsystems[sites[site].subsystem].counters, size);
+
+  pthread_mutex_unlock(&lock);
+}
+
+// Forget the allocation at PTR - return whether it was tracked, and if
+// so put it into ALLOC.
+static bool untrack(void* ptr, live_alloc* alloc) {
+  pthread_mutex_lock(&lock);
+  bool tracked = remove_live(ptr, alloc);
+  if (tracked) {
+    remove_bytes(&totals, alloc->size);
+    remove_bytes(&sites[alloc->site].counters, alloc->size);
+    remove_bytes(&subsystems[sites[alloc->site].subsystem].counters,
+                 alloc->size);
+  }
+  pthread_mutex_unlock(&lock);
+  return tracked;
+}
+
+void* accounted_malloc(size_t size, const char* file, const char* func,
+                       int line) {
+  void* ptr = malloc(size);
+  if (ptr != NULL) {
+    track(ptr, size, file, func, line);
+  }
+  return ptr;
+}
+
+void* accounted_calloc(size_t count, size_t size, const char* file,
+                       const char* func, int line) {
+  void* ptr = calloc(count, size);
+  if (ptr != NULL) {
+    track(ptr, count * size, file, func, line);
+  }
+  return ptr;
+}
+
+void* accounted_realloc(void* ptr, size_t size, const char* file,
+                        const char* func, int line) {
+  // The old allocation is forgotten first, as once it is released
+  // another thread may be given the same address.
+  live_alloc old;
+  bool tracked = ptr != NULL && untrack(ptr, &old);
+
+  void* new_ptr = realloc(ptr, size);
+  if (new_ptr != NULL) {
+    track(new_ptr, size, file, func, line);
+  } else if (tracked && size != 0) {
+    // Failed, so the old allocation lives on.
+    track(ptr, old.size, sites[old.site].file, sites[old.site].func,
+          sites[old.site].line);
+  }
+  return new_ptr;
+}
+
+void* accounted_aligned_alloc(size_t alignment, size_t size, const char* file,
+                              const char* func, int line) {
+  void* ptr = aligned_alloc(alignment, size);
+  if (ptr != NULL) {
+    track(ptr, size, file, func, line);
+  }
+  return ptr;
+}
+
+void accounted_free(void* ptr) {
+  if (ptr != NULL) {
+    // Memory from outside the library, e.g. open_memstream, is not
+    // tracked but freed all the same.
+    live_alloc alloc;
+    untrack(ptr, &alloc);
+  }
+  free(ptr);
+}
+
+alloc_counters alloc_totals() {
+  pthread_mutex_lock(&lock);
+  alloc_counters result = totals;
+  pthread_mutex_unlock(&lock);
+  return result;
+}
+
+static void print_counters(const char* name, alloc_counters* counters) {
+  fprintf(stderr, "  %-48.48s %12lu %12lu %14lu %10lu %10lu\n", name,
+          counters->live_bytes, counters->peak_bytes, counters->total_bytes,
+          counters->calls, counters->frees);
+}
+
+static int by_descending_peak(const void* a, const void* b) {
+  uint64_t peak_a = sites[*(const size_t*)a].counters.peak_bytes;
+  uint64_t peak_b = sites[*(const size_t*)b].counters.peak_bytes;
+  return (peak_a < peak_b) - (peak_a > peak_b);
+}
+
+void print_alloc_report(const char* phase) {
+  if (!alloc_accounting_enabled()) {
+    fprintf(stderr,
+            "allocations after %s: not accounted, build with "
+            "DEFINES=-DALLOC_ACCOUNTING\n",
+            phase);
+    return;
+  }
+
+  pthread_mutex_lock(&lock);
+  fprintf(stderr, "allocations after %s:\n", phase);
+  fprintf(stderr, "  %-48s %12s %12s %14s %10s %10s\n", "", "live B",
+          "peak B", "total B", "calls", "frees");
+  print_counters("all", &totals);
+
+  for (size_t i = 0; i < num_subsystems; i += 1) {
+    print_counters(subsystems[i].name, &subsystems[i].counters);
+  }
+
+  // Call sites, largest first.
+  size_t used[MAX_SITES + 1];
+  size_t num_used = 0;
+  for (size_t i = 0; i <= MAX_SITES; i += 1) {
+    if (sites[i].file != NULL) {
+      used[num_used++] = i;
+    }
+  }
+  qsort(used, num_used, sizeof(size_t), by_descending_peak);
+  for (size_t i = 0; i < num_used; i += 1) {
+    alloc_site* site = &sites[used[i]];
+    const char* base = strrchr(site->file, '/');
+    char name[96];
+    snprintf(name, sizeof(name), "%s:%d %s",
+             base == NULL ? site->file : base + 1, site->line, site->func);
+    print_counters(name, &site->counters);
+  }
+  pthread_mutex_unlock(&lock);
+}
+
+size_t report_alloc_leaks(FILE* out) {
+  pthread_mutex_lock(&lock);
+  size_t leaks  = live_occupied;
+  size_t listed = 0;
+  for (size_t i = 0; i < live_allocated && listed < MAX_LISTED_LEAKS; i += 1) {
+    if (live[i].ptr != NULL) {
+      alloc_site* site = &sites[live[i].site];
+      fprintf(out, "leak: %lu bytes at %p from %s:%d (%s)\n", live[i].size,
+              live[i].ptr, site->file, site->line, site->func);
+      listed += 1;
+    }
+  }
+  if (leaks > listed) {
+    fprintf(out, "leak: ... and %lu more\n", leaks - listed);
+  }
+  if (leaks > 0) {
+    fprintf(out, "leak: %lu allocations, %lu bytes still live\n", leaks,
+            totals.live_bytes);
+  }
+  pthread_mutex_unlock(&lock);
+  return leaks;
+}
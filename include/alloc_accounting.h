@@ -0,0 +1,68 @@
+/*
+  Accounting of the heap use of the library. When built with
+  -DALLOC_ACCOUNTING, every malloc, calloc, realloc, aligned_alloc and
+  free in a file including this header is routed through a tracker
+  recording bytes live, peak bytes and call counts per call site and
+  per subsystem - the source file. Text built by the pretty printers
+  is counted under text_writer.
+  Otherwise the wrappers are not compiled in at all, and the reports
+  say so.
+
+  This header is included by every library source and, through
+  data.h, by everything using the library - so what one side
+  allocates is tracked when the other frees it.
+ */
+
+#ifndef ALLOC_ACCOUNTING_H
+#define ALLOC_ACCOUNTING_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+typedef struct {
+  uint64_t live_bytes;  // Bytes currently allocated.
+  uint64_t peak_bytes;  // Most bytes ever allocated at once.
+  uint64_t total_bytes; // Bytes allocated over all time.
+  uint64_t calls;       // Allocating calls, reallocs included.
+  uint64_t frees;       // Frees of tracked memory.
+} alloc_counters;
+
+// Return whether allocations are being accounted.
+bool alloc_accounting_enabled();
+
+// Return the counters of all accounted allocations.
+alloc_counters alloc_totals();
+
+// Print the per-subsystem and per-call site counters to stderr, under
+// the heading PHASE.
+void print_alloc_report(const char* phase);
+
+// Print every allocation still live to OUT, with its call site, and
+// return how many there are. Run with AOC_LEAK_CHECK=1 to do so at exit
+// and fail if there are any.
+size_t report_alloc_leaks(FILE* out);
+
+void* accounted_malloc(size_t size, const char* file, const char* func,
+                       int line);
+void* accounted_calloc(size_t count, size_t size, const char* file,
+                       const char* func, int line);
+void* accounted_realloc(void* ptr, size_t size, const char* file,
+                        const char* func, int line);
+void* accounted_aligned_alloc(size_t alignment, size_t size, const char* file,
+                              const char* func, int line);
+void accounted_free(void* ptr);
+
+#if defined(ALLOC_ACCOUNTING) && !defined(ALLOC_ACCOUNTING_IMPLEMENTATION)
+#define malloc(size) accounted_malloc(size, __FILE__, __func__, __LINE__)
+#define calloc(count, size)                                                    \
+  accounted_calloc(count, size, __FILE__, __func__, __LINE__)
+#define realloc(ptr, size)                                                     \
+  accounted_realloc(ptr, size, __FILE__, __func__, __LINE__)
+#define aligned_alloc(alignment, size)                                         \
+  accounted_aligned_alloc(alignment, size, __FILE__, __func__, __LINE__)
+#define free(ptr) accounted_free(ptr)
+#endif
+
+#endif
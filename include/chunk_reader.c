@@ -0,0 +1,453 @@
+#define _GNU_SOURCE // For memrchr.
+
+#include <assert.h>
+#include <errno.h>
+#include <linux/io_uring.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "./alloc_accounting.h"
+#include "./chunk_reader.h"
+
+//// Reading into buffers.
+
+// Read from FD into BUF (already holding FILLED bytes) until it is full
+// or the input ends. Return the number of bytes now in BUF.
+size_t fill_buffer(chunk_reader* reader, chunk_reader_buffer* buf,
+                   size_t filled) {
+  uint64_t offset = reader->start + buf->index * CHUNK_READER_BUFFER_SIZE;
+  while (filled < CHUNK_READER_BUFFER_SIZE) {
+    ssize_t got;
+    if (reader->seekable) {
+      got = pread(reader->fd, buf->data + filled,
+                  CHUNK_READER_BUFFER_SIZE - filled, offset + filled);
+    } else {
+      got = read(reader->fd, buf->data + filled,
+                 CHUNK_READER_BUFFER_SIZE - filled);
+    }
+
+    if (got < 0 && errno == EINTR) {
+      continue;
+    } else if (got < 0) {
+      perror("Error reading input");
+      exit(-1);
+    } else if (got == 0) {
+      break;
+    }
+    filled += got;
+  }
+  return filled;
+}
+
+//// io_uring backend.
+
+int io_uring_setup(unsigned entries, struct io_uring_params* params) {
+  return syscall(__NR_io_uring_setup, entries, params);
+}
+
+int io_uring_enter(int ring_fd, unsigned to_submit, unsigned min_complete,
+                   unsigned flags) {
+  return syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete, flags,
+                 NULL, 0);
+}
+
+// Set up the rings of READER. Return whether io_uring is usable.
+bool init_ring(chunk_reader* reader) {
+  struct io_uring_params params;
+  memset(&params, 0, sizeof(params));
+
+  reader->ring_fd = io_uring_setup(CHUNK_READER_DEPTH, &params);
+  if (reader->ring_fd < 0) {
+    return false;
+  }
+
+  reader->sq_ring_size =
+      params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  reader->cq_ring_size =
+      params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+  reader->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+
+  // Newer kernels map both rings with a single mmap.
+  bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+  if (single_mmap) {
+    if (reader->cq_ring_size > reader->sq_ring_size) {
+      reader->sq_ring_size = reader->cq_ring_size;
+    }
+    reader->cq_ring_size = reader->sq_ring_size;
+  }
+
+  reader->sq_ring = mmap(NULL, reader->sq_ring_size, PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_POPULATE, reader->ring_fd,
+                         IORING_OFF_SQ_RING);
+  if (single_mmap) {
+    reader->cq_ring = reader->sq_ring;
+  } else {
+    reader->cq_ring = mmap(NULL, reader->cq_ring_size, PROT_READ | PROT_WRITE,
+                           MAP_SHARED | MAP_POPULATE, reader->ring_fd,
+                           IORING_OFF_CQ_RING);
+  }
+  reader->sqes = mmap(NULL, reader->sqes_size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, reader->ring_fd,
+                      IORING_OFF_SQES);
+  if (reader->sq_ring == MAP_FAILED || reader->cq_ring == MAP_FAILED ||
+      reader->sqes == MAP_FAILED) {
+    close(reader->ring_fd);
+    return false;
+  }
+
+  char* sq          = reader->sq_ring;
+  char* cq          = reader->cq_ring;
+  reader->sq_tail   = (unsigned*)(sq + params.sq_off.tail);
+  reader->sq_mask   = (unsigned*)(sq + params.sq_off.ring_mask);
+  reader->sq_array  = (unsigned*)(sq + params.sq_off.array);
+  reader->cq_head   = (unsigned*)(cq + params.cq_off.head);
+  reader->cq_tail   = (unsigned*)(cq + params.cq_off.tail);
+  reader->cq_mask   = (unsigned*)(cq + params.cq_off.ring_mask);
+  reader->cqes      = cq + params.cq_off.cqes;
+  reader->in_flight = 0;
+
+  return true;
+}
+
+void free_ring(chunk_reader* reader) {
+  munmap(reader->sqes, reader->sqes_size);
+  if (reader->cq_ring != reader->sq_ring) {
+    munmap(reader->cq_ring, reader->cq_ring_size);
+  }
+  munmap(reader->sq_ring, reader->sq_ring_size);
+  close(reader->ring_fd);
+}
+
+// Queue a read of piece INDEX of the input into the buffer at SLOT.
+void submit_read(chunk_reader* reader, size_t slot, uint64_t index) {
+  chunk_reader_buffer* buf = &reader->buffers[slot];
+  buf->index               = index;
+  buf->filled              = 0;
+  buf->ready               = false;
+
+  uint64_t offset = reader->start + index * CHUNK_READER_BUFFER_SIZE;
+  if (offset >= reader->file_size) {
+    // Past the end - nothing to wait for.
+    buf->ready = true;
+    return;
+  }
+
+  unsigned tail = *reader->sq_tail;
+  unsigned idx  = tail & *reader->sq_mask;
+
+  struct io_uring_sqe* sqe = &((struct io_uring_sqe*)reader->sqes)[idx];
+  memset(sqe, 0, sizeof(struct io_uring_sqe));
+  sqe->opcode    = IORING_OP_READ;
+  sqe->fd        = reader->fd;
+  sqe->addr      = (uint64_t)buf->data;
+  sqe->len       = CHUNK_READER_BUFFER_SIZE;
+  sqe->off       = offset;
+  sqe->user_data = slot;
+
+  reader->sq_array[idx] = idx;
+  atomic_store_explicit((_Atomic unsigned*)reader->sq_tail, tail + 1,
+                        memory_order_release);
+  reader->in_flight += 1;
+
+  if (io_uring_enter(reader->ring_fd, 1, 0, 0) < 0) {
+    // Could not hand the read to the kernel - do it synchronously.
+    atomic_store_explicit((_Atomic unsigned*)reader->sq_tail, tail,
+                          memory_order_release);
+    reader->in_flight -= 1;
+    buf->filled = fill_buffer(reader, buf, 0);
+    buf->ready  = true;
+  }
+}
+
+// Wait for and process one completed read.
+void reap_read(chunk_reader* reader) {
+  unsigned head = *reader->cq_head;
+  unsigned tail = atomic_load_explicit((_Atomic unsigned*)reader->cq_tail,
+                                       memory_order_acquire);
+  while (head == tail) {
+    io_uring_enter(reader->ring_fd, 0, 1, IORING_ENTER_GETEVENTS);
+    tail = atomic_load_explicit((_Atomic unsigned*)reader->cq_tail,
+                                memory_order_acquire);
+  }
+
+  struct io_uring_cqe* cqe =
+      &((struct io_uring_cqe*)reader->cqes)[head & *reader->cq_mask];
+  chunk_reader_buffer* buf = &reader->buffers[cqe->user_data];
+  int res                  = cqe->res;
+  atomic_store_explicit((_Atomic unsigned*)reader->cq_head, head + 1,
+                        memory_order_release);
+  reader->in_flight -= 1;
+
+  // A failed or short read (say, the kernel does not know
+  // IORING_OP_READ) is finished off synchronously.
+  size_t filled = res < 0 ? 0 : res;
+  if (filled < CHUNK_READER_BUFFER_SIZE) {
+    filled = fill_buffer(reader, buf, filled);
+  }
+  buf->filled = filled;
+  buf->ready  = true;
+}
+
+//// Reader thread backend.
+
+void* reader_thread_main(void* v_reader) {
+  chunk_reader* reader = v_reader;
+
+  pthread_mutex_lock(&reader->lock);
+  while (true) {
+    // Wait for the buffer of the next piece to be handed back.
+    while (!reader->stopping &&
+           reader->next_to_read >= reader->next_to_hand + CHUNK_READER_DEPTH) {
+      pthread_cond_wait(&reader->cond, &reader->lock);
+    }
+    if (reader->stopping) {
+      break;
+    }
+
+    uint64_t index           = reader->next_to_read;
+    chunk_reader_buffer* buf = &reader->buffers[index % CHUNK_READER_DEPTH];
+    buf->index               = index;
+    pthread_mutex_unlock(&reader->lock);
+
+    size_t filled = fill_buffer(reader, buf, 0);
+
+    pthread_mutex_lock(&reader->lock);
+    buf->filled = filled;
+    buf->ready  = true;
+    reader->next_to_read += 1;
+    pthread_cond_broadcast(&reader->cond);
+
+    if (filled < CHUNK_READER_BUFFER_SIZE) {
+      // End of input.
+      break;
+    }
+  }
+  pthread_mutex_unlock(&reader->lock);
+
+  return NULL;
+}
+
+//// The reader.
+
+// Start a chunk reader over FD from byte OFFSET, through BACKEND if FD
+// allows it.
+chunk_reader* start_chunk_reader(int fd, chunk_reader_backend backend,
+                                 uint64_t offset) {
+  chunk_reader* reader = calloc(1, sizeof(chunk_reader));
+  reader->fd           = fd;
+
+  // io_uring reads at explicit offsets, so needs to know where the
+  // input ends. Anything but a regular file goes through the thread.
+  struct stat st;
+  bool regular      = fstat(fd, &st) == 0 && S_ISREG(st.st_mode);
+  reader->seekable  = regular;
+  reader->file_size = regular ? st.st_size : 0;
+  assert(regular || offset == 0);
+  reader->start = offset;
+  if (!regular || (backend == IO_URING && !init_ring(reader))) {
+    backend = READER_THREAD;
+  }
+  reader->backend = backend;
+
+  for (size_t i = 0; i < CHUNK_READER_DEPTH; i += 1) {
+    reader->buffers[i].data = malloc(CHUNK_READER_BUFFER_SIZE);
+  }
+
+  if (backend == IO_URING) {
+    for (size_t i = 0; i < CHUNK_READER_DEPTH; i += 1) {
+      submit_read(reader, i, i);
+    }
+    reader->next_to_read = CHUNK_READER_DEPTH;
+  } else {
+    pthread_mutex_init(&reader->lock, NULL);
+    pthread_cond_init(&reader->cond, NULL);
+    pthread_create(&reader->thread, NULL, reader_thread_main, reader);
+  }
+
+  return reader;
+}
+
+chunk_reader_backend backend_from_environment() {
+  char* backend = getenv("AOC_READER");
+  if (backend != NULL && strcmp(backend, "thread") == 0) {
+    return READER_THREAD;
+  }
+  return IO_URING;
+}
+
+chunk_reader* init_chunk_reader(int fd) {
+  return start_chunk_reader(fd, backend_from_environment(), 0);
+}
+
+chunk_reader* init_chunk_reader_at(int fd, uint64_t offset) {
+  return start_chunk_reader(fd, backend_from_environment(), offset);
+}
+
+chunk_reader* init_chunk_reader_with_backend(int fd,
+                                             chunk_reader_backend backend) {
+  return start_chunk_reader(fd, backend, 0);
+}
+
+void free_chunk_reader(chunk_reader* reader) {
+  if (reader->backend == IO_URING) {
+    // The kernel may still be writing into the buffers.
+    while (reader->in_flight > 0) {
+      reap_read(reader);
+    }
+    free_ring(reader);
+  } else {
+    pthread_mutex_lock(&reader->lock);
+    reader->stopping = true;
+    pthread_cond_broadcast(&reader->cond);
+    pthread_mutex_unlock(&reader->lock);
+
+    pthread_join(reader->thread, NULL);
+    pthread_mutex_destroy(&reader->lock);
+    pthread_cond_destroy(&reader->cond);
+  }
+
+  for (size_t i = 0; i < CHUNK_READER_DEPTH; i += 1) {
+    free(reader->buffers[i].data);
+  }
+  free(reader->stitch);
+  free(reader);
+}
+
+// Return the buffer holding the next piece of input, once it is read.
+chunk_reader_buffer* acquire_piece(chunk_reader* reader) {
+  chunk_reader_buffer* buf =
+      &reader->buffers[reader->next_to_hand % CHUNK_READER_DEPTH];
+
+  if (reader->backend == IO_URING) {
+    while (!buf->ready) {
+      reap_read(reader);
+    }
+  } else {
+    pthread_mutex_lock(&reader->lock);
+    while (!(buf->ready && buf->index == reader->next_to_hand)) {
+      pthread_cond_wait(&reader->cond, &reader->lock);
+    }
+    pthread_mutex_unlock(&reader->lock);
+  }
+
+  return buf;
+}
+
+// Hand the buffer of the current piece back to be read into again.
+void release_piece(chunk_reader* reader) {
+  chunk_reader_buffer* buf = reader->current;
+  reader->current          = NULL;
+
+  if (reader->backend == IO_URING) {
+    reader->next_to_hand += 1;
+    if (!reader->at_eof) {
+      size_t slot = buf - reader->buffers;
+      submit_read(reader, slot, reader->next_to_read);
+      reader->next_to_read += 1;
+    }
+  } else {
+    pthread_mutex_lock(&reader->lock);
+    buf->ready = false;
+    reader->next_to_hand += 1;
+    pthread_cond_broadcast(&reader->cond);
+    pthread_mutex_unlock(&reader->lock);
+  }
+}
+
+// Append LENGTH bytes at DATA to the line being stitched together.
+void append_to_stitch(chunk_reader* reader, const char* data, size_t length) {
+  // Nothing to carry over - and no stitch to copy into, the first time.
+  if (length == 0) {
+    return;
+  }
+  if (reader->stitch_length + length > reader->stitch_allocated) {
+    size_t new_allocation_size = 2 * (reader->stitch_length + length);
+    reader->stitch             = realloc(reader->stitch, new_allocation_size);
+    reader->stitch_allocated   = new_allocation_size;
+  }
+  memcpy(reader->stitch + reader->stitch_length, data, length);
+  reader->stitch_length += length;
+}
+
+const char* next_chunk(chunk_reader* reader, size_t* length) {
+  // The stitched line handed out last time is done with.
+  if (reader->stitch_handed) {
+    reader->stitch_length = 0;
+    reader->stitch_handed = false;
+  }
+
+  while (true) {
+    if (reader->current == NULL) {
+      if (reader->at_eof) {
+        // A final line without a newline.
+        if (reader->stitch_length > 0) {
+          reader->stitch_handed = true;
+          *length               = reader->stitch_length;
+          return reader->stitch;
+        }
+        return NULL;
+      }
+
+      reader->current        = acquire_piece(reader);
+      reader->current_offset = 0;
+      if (reader->current->filled < CHUNK_READER_BUFFER_SIZE) {
+        reader->at_eof = true;
+      }
+    }
+
+    chunk_reader_buffer* buf = reader->current;
+    char* start              = buf->data + reader->current_offset;
+    size_t remaining         = buf->filled - reader->current_offset;
+
+    if (reader->stitch_length > 0) {
+      // Complete the line carried over from the previous buffer.
+      char* newline = memchr(start, '\n', remaining);
+      if (newline == NULL) {
+        append_to_stitch(reader, start, remaining);
+        release_piece(reader);
+        continue;
+      }
+
+      append_to_stitch(reader, start, newline - start + 1);
+      reader->current_offset += newline - start + 1;
+      reader->stitch_handed = true;
+      *length               = reader->stitch_length;
+      return reader->stitch;
+    }
+
+    char* last_newline = memrchr(start, '\n', remaining);
+    if (last_newline == NULL) {
+      append_to_stitch(reader, start, remaining);
+      release_piece(reader);
+      continue;
+    }
+
+    // Hand out the whole lines straight from the buffer, carrying over
+    // the partial line after them. The buffer is released next time.
+    size_t body_length = last_newline - start + 1;
+    append_to_stitch(reader, last_newline + 1, remaining - body_length);
+    reader->current_offset = buf->filled;
+    *length                = body_length;
+    return start;
+  }
+}
+
+const char* parse_uint64(const char* cursor, const char* end,
+                         uint64_t* value) {
+  uint64_t result = 0;
+  while (cursor < end && *cursor >= '0' && *cursor <= '9') {
+    result = result * 10 + (*cursor - '0');
+    cursor += 1;
+  }
+  *value = result;
+  return cursor;
+}
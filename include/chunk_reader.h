@@ -0,0 +1,106 @@
+/*
+  An input source which keeps several large reads in flight - through
+  io_uring where the kernel allows, else through a reader thread - and
+  hands out chunks made of whole lines while the next reads are
+  pending.
+ */
+
+#ifndef CHUNK_READER_H
+#define CHUNK_READER_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#define CHUNK_READER_BUFFER_SIZE (1 << 20)
+
+// Number of buffers being read into or handed out at once.
+#define CHUNK_READER_DEPTH 4
+
+typedef enum {
+  IO_URING,     // Reads are queued on an io_uring.
+  READER_THREAD // A thread preads ahead into the buffers.
+} chunk_reader_backend;
+
+typedef struct {
+  char* data;
+  size_t filled;  // Bytes read into data.
+  bool ready;     // Whether the read into data has finished.
+  uint64_t index; // Which buffer-sized piece of the input this holds.
+} chunk_reader_buffer;
+
+typedef struct {
+  chunk_reader_backend backend;
+  int fd;
+  bool seekable;
+  uint64_t start;     // Offset in the file of the first byte read.
+  uint64_t file_size; // Only known (non-zero) for regular files.
+
+  chunk_reader_buffer buffers[CHUNK_READER_DEPTH];
+  uint64_t next_to_read; // Index of the next piece of input to request.
+  uint64_t next_to_hand; // Index of the next piece to hand out.
+  bool at_eof;           // Whether the piece being handed out was the last.
+
+  // The current buffer is handed out as: a stitched chunk completing
+  // the line carried over from before, then its remaining whole lines.
+  chunk_reader_buffer* current;
+  size_t current_offset;
+  char* stitch;
+  size_t stitch_length;
+  size_t stitch_allocated;
+  bool stitch_handed; // Whether the stitched line was just handed out.
+
+  // io_uring state - the mapped rings and the fields used within them.
+  int ring_fd;
+  void* sq_ring;
+  size_t sq_ring_size;
+  void* cq_ring;
+  size_t cq_ring_size;
+  void* sqes;
+  size_t sqes_size;
+  unsigned* sq_tail;
+  unsigned* sq_mask;
+  unsigned* sq_array;
+  unsigned* cq_head;
+  unsigned* cq_tail;
+  unsigned* cq_mask;
+  void* cqes;
+  size_t in_flight; // Reads submitted but not yet reaped.
+
+  // Reader thread state.
+  pthread_t thread;
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  bool stopping;
+} chunk_reader;
+
+// Initialize a chunk reader over the open file descriptor FD, which
+// stays owned by the caller. The environment variable
+// AOC_READER=thread forces the reader thread backend.
+chunk_reader* init_chunk_reader(int fd);
+
+// Initialize a chunk reader over FD using the given BACKEND - which
+// falls back to READER_THREAD if io_uring cannot be used for FD.
+chunk_reader* init_chunk_reader_with_backend(int fd,
+                                             chunk_reader_backend backend);
+
+// Initialize a chunk reader over the open regular file FD, reading
+// from byte OFFSET onwards - as init_chunk_reader otherwise.
+chunk_reader* init_chunk_reader_at(int fd, uint64_t offset);
+
+// Free the given chunk reader READER.
+void free_chunk_reader(chunk_reader* reader);
+
+// Return the next chunk of input from READER and store its length in
+// LENGTH, or return NULL once the input is exhausted. Chunks hold whole
+// lines, except that the last one may lack its final newline. A chunk
+// stays valid until the next call.
+const char* next_chunk(chunk_reader* reader, size_t* length);
+
+// Parse the decimal number at the start of [CURSOR, END) into VALUE.
+// Return where the digits end, which is CURSOR if there are none.
+const char* parse_uint64(const char* cursor, const char* end,
+                         uint64_t* value);
+
+#endif
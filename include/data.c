@@ -2,6 +2,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include "./alloc_accounting.h"
 #include "./data.h"
 #include "./dyn_array.h"
 
@@ -17,7 +18,11 @@ size_t size_of_data_type(data_type_t type) {
 }
 
 int compare_int(const void* v1, const void* v2) {
-  return *(uint64_t*)v1 - *(uint64_t*)v2;
+  // Not a subtraction, which truncated to int misorders values 2^31 or
+  // more apart.
+  uint64_t a = *(uint64_t*)v1;
+  uint64_t b = *(uint64_t*)v2;
+  return (a > b) - (a < b);
 }
 
 int (*comparator_for_data_type(data_type_t type))(const void* a, const void*) {
@@ -32,32 +37,26 @@ int (*comparator_for_data_type(data_type_t type))(const void* a, const void*) {
   exit(-1);
 }
 
-#define PP_LENGTH 2
+// Printed as signed, as they always have been.
+void write_uint64_value(text_writer* writer, const void* v) {
+  write_int64(writer, (int64_t)v);
+}
 
 char* pp_uint64(const void* v) {
-  // Initally the buffer has space for one character and \0.
-  char* pp_buf = malloc(PP_LENGTH * sizeof(char));
-
-  // Attempt to put the entire integer into pp_buf. This result is the
-  // number of characters snprintf tried to put into the buffer, not
-  // including the \0.
-  size_t pp_length = snprintf(pp_buf, PP_LENGTH, "%ld", (uint64_t)v);
-
-  // If the length of the given integer PLUS the \0 is bigger than the
-  // size of pp_buf, reallocate it.
-  if ((pp_length + 1) >= PP_LENGTH) {
-    pp_buf = realloc(pp_buf, (pp_length + 1) * sizeof(char));
-    snprintf(pp_buf, (pp_length + 1), "%ld", (uint64_t)v);
-  }
-
-  return pp_buf;
+  text_writer* writer = init_string_writer();
+  write_uint64_value(writer, v);
+  return finish_string_writer(writer);
 }
 
-// Wrapper to allow meaningful signature of function in dyn_array.h
+// Wrappers to allow meaningful signatures of functions in dyn_array.h
 char* pp_dyn_array_help(const void* v) {
   return pp_dyn_array((dyn_array*)v);
 }
 
+void write_dyn_array_help(text_writer* writer, const void* v) {
+  write_dyn_array(writer, (dyn_array*)v);
+}
+
 char* (*pp_for_data_type(data_type_t type))(const void*) {
   switch (type) {
   case UINT64:
@@ -69,6 +68,17 @@ char* (*pp_for_data_type(data_type_t type))(const void*) {
   exit(-1);
 }
 
+void (*writer_for_data_type(data_type_t type))(text_writer*, const void*) {
+  switch (type) {
+  case UINT64:
+    return write_uint64_value;
+  case DYN_ARRAY:
+    return write_dyn_array_help;
+  }
+  printf("The C type system has been defeated.");
+  exit(-1);
+}
+
 uint64_t hash_uint64(const void* v) {
   return (uint64_t)v;
 }
@@ -97,13 +107,38 @@ static uint64_t hash_of_key(const void* key, data_type_t type) {
 ////
 */
 
+// Wrapper to allow meaningful signature of function in dyn_array.h
+uint64_t hash_dyn_array_help(const void* v) {
+  return hash_of_dyn_array((dyn_array*)v);
+}
+
 uint64_t (*hasher_for_data_type(data_type_t type))(const void*) {
   switch (type) {
   case UINT64:
     return hash_uint64;
   case DYN_ARRAY:
-    printf("Hashing dyn_array is currently unsupported.");
-    exit(-1);
+    return hash_dyn_array_help;
+  }
+  printf("The C type system has been defeated.");
+  exit(-1);
+}
+
+bool equal_uint64s(const void* a, const void* b) {
+  return a == b;
+}
+
+// Wrapper to allow meaningful signature of function in dyn_array.h
+bool equal_dyn_arrays_help(const void* a, const void* b) {
+  return equal_dyn_arrays((dyn_array*)a, (dyn_array*)b);
+}
+
+bool (*equality_for_data_type(data_type_t type))(const void* a,
+                                                  const void* b) {
+  switch (type) {
+  case UINT64:
+    return equal_uint64s;
+  case DYN_ARRAY:
+    return equal_dyn_arrays_help;
   }
   printf("The C type system has been defeated.");
   exit(-1);
@@ -6,9 +6,13 @@
 #ifndef DATA_TYPE_H
 #define DATA_TYPE_H
 
+#include <stdbool.h>
 #include <stdint.h>
 #include <stdlib.h>
 
+#include "./alloc_accounting.h"
+#include "./text_writer.h"
+
 typedef enum {
   UINT64,   // raw uint64_t - NOT A POINTER/REFERENCE TO ONE!!!
   DYN_ARRAY // pointer to a dyn_array
@@ -23,8 +27,19 @@ int (*comparator_for_data_type(data_type_t type))(const void*, const void*);
 // Return a pretty printing function for the given data TYPE.
 char* (*pp_for_data_type(data_type_t type))(const void*);
 
+// Return a function writing the pretty printed form of a value of the
+// given data TYPE to a text_writer.
+void (*writer_for_data_type(data_type_t type))(text_writer*, const void*);
+
+// Return a hash function for the given data TYPE - by value for
+// UINT64, by contents for DYN_ARRAY.
 uint64_t (*hasher_for_data_type(data_type_t type))(const void*);
 
+// Return an equality function for the given data TYPE, agreeing with
+// its hash function.
+bool (*equality_for_data_type(data_type_t type))(const void* a,
+                                                  const void* b);
+
 // Return a copier function for the given data TYPE.
 void* (*copier_for_data_type(data_type_t type))(const void* v);
 
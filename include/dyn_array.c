@@ -1,8 +1,10 @@
+#include <assert.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 
+#include "./alloc_accounting.h"
 #include "./data.h"
 #include "./dyn_array.h"
 
@@ -11,9 +13,11 @@ dyn_array* init_dyn_array(data_type_t type) {
   dyn_array* result = calloc(1, sizeof(dyn_array));
 
   // Assign properties.
-  result->data_type = type;
-  result->occupied  = 0;
-  result->allocated = DYN_ARRAY_INIT_SIZE;
+  result->data_type      = type;
+  result->occupied       = 0;
+  result->allocated      = DYN_ARRAY_INIT_SIZE;
+  result->growth_factor  = DYN_ARRAY_GROWTH_FACTOR;
+  result->fill_threshold = DYN_ARRAY_FILL_THRESHOLD;
 
   // Allocate appropriately sized data array for the data type.
   result->data = calloc(result->allocated, size_of_data_type(type));
@@ -26,41 +30,66 @@ void set_data_array_element(void* data, const void* el, size_t index,
   switch (type) {
   case UINT64:
     ((uint64_t*)data)[index] = (uint64_t)el;
+    break;
   case DYN_ARRAY:
     ((dyn_array**)data)[index] = (dyn_array*)el;
+    break;
   }
 }
 
-dyn_array* copy_dyn_array(dyn_array* arr) {
-  // Allocate new empty array.
-  dyn_array* copy = init_dyn_array(arr->data_type);
+// Re-allocate the data array of ARR to hold NEW_ALLOCATION_SIZE
+// elements.
+void reallocate_dyn_array(dyn_array* arr, size_t new_allocation_size) {
+  // Always keep some allocation around, realloc to 0 may free.
+  if (new_allocation_size == 0) {
+    new_allocation_size = 1;
+  }
 
-  // Copy properties over.
-  copy->occupied  = arr->occupied;
-  copy->allocated = arr->allocated;
+  arr->data      = realloc(arr->data, new_allocation_size *
+                                          size_of_data_type(arr->data_type));
+  arr->allocated = new_allocation_size;
+}
 
-  // Allocated the contents array of the needed size. Free what was initialized.
-  free(copy->data);
-  copy->data = calloc(arr->allocated, size_of_data_type(arr->data_type));
+// Grow the data array of ARR as its growth policy dictates, until it
+// can hold NEEDED elements.
+void grow_dyn_array(dyn_array* arr, size_t needed) {
+  if (needed <= arr->allocated * arr->fill_threshold) {
+    return;
+  }
 
-  // Copy the data in - raw access to the underlying array without
-  // needing the full push procedure.
-  void* (*copier)(const void* v) = copier_for_data_type(arr->data_type);
-  for (size_t i = 0; i < arr->allocated; i += 1) {
-    void* el = get_element_of_dyn_array(arr, i);
-    if (el != NULL) {
-      void* el_copy = copier(el);
-      set_data_array_element(copy->data, el_copy, i, arr->data_type);
-    }
+  size_t new_allocation_size = arr->allocated;
+  while (needed > new_allocation_size * arr->fill_threshold) {
+    size_t grown = new_allocation_size * arr->growth_factor;
+    // Always make progress, even with a factor close to 1.
+    new_allocation_size =
+        grown > new_allocation_size ? grown : new_allocation_size + 1;
   }
 
+  reallocate_dyn_array(arr, new_allocation_size);
+}
+
+dyn_array* copy_dyn_array(dyn_array* arr) {
+  // Allocate new empty array, with the same growth policy.
+  dyn_array* copy = init_dyn_array(arr->data_type);
+  set_growth_policy_of_dyn_array(copy, arr->growth_factor,
+                                 arr->fill_threshold);
+
+  // The copy only needs room for what is populated, not for the
+  // original's spare capacity.
+  reserve_dyn_array(copy, arr->occupied);
+  append_dyn_array_onto_dyn_array(copy, arr);
+
+  // Equal contents, equal hash.
+  copy->hash       = arr->hash;
+  copy->hash_valid = arr->hash_valid;
+
   return copy;
 }
 
 void free_dyn_array(dyn_array* arr) {
   void (*freer)(const void* v) = freer_for_data_type(arr->data_type);
 
-  for (size_t i = 0; i < arr->allocated; i += 1) {
+  for (size_t i = 0; i < arr->occupied; i += 1) {
     void* el = get_element_of_dyn_array(arr, i);
     if (el != NULL) {
       freer(el);
@@ -90,42 +119,188 @@ void* get_element_of_dyn_array(dyn_array* arr, size_t idx) {
 }
 
 void push_onto_dyn_array(dyn_array* arr, const void* el) {
-  if (arr->occupied + 1 > (arr->allocated / 2)) {
-    // Re-allocate a larger data buffer.
-    size_t new_allocation_size = 2 * arr->allocated;
-    void* new_data             = realloc(arr->data, new_allocation_size *
-                                                        size_of_data_type(arr->data_type));
-
-    arr->data      = new_data;
-    arr->allocated = new_allocation_size;
-  }
+  grow_dyn_array(arr, arr->occupied + 1);
 
   void* (*copier)(const void* v) = copier_for_data_type(arr->data_type);
   void* el_copy                  = copier(el);
   set_data_array_element(arr->data, el_copy, arr->occupied, arr->data_type);
 
   arr->occupied += 1;
+  invalidate_hash_of_dyn_array(arr);
   return;
 }
 
+void append_uint64s_onto_dyn_array(dyn_array* arr, const uint64_t* values,
+                                   size_t count) {
+  assert(arr->data_type == UINT64);
+
+  grow_dyn_array(arr, arr->occupied + count);
+
+  // Raw values are their own copies, so they can be moved wholesale.
+  memcpy((uint64_t*)arr->data + arr->occupied, values,
+         count * sizeof(uint64_t));
+  arr->occupied += count;
+  invalidate_hash_of_dyn_array(arr);
+}
+
+void append_dyn_array_onto_dyn_array(dyn_array* arr, dyn_array* other) {
+  assert(arr->data_type == other->data_type);
+
+  // Grow first - OTHER may be ARR itself, whose data array moves.
+  size_t count = other->occupied;
+  grow_dyn_array(arr, arr->occupied + count);
+
+  switch (arr->data_type) {
+  case UINT64:
+    memcpy((uint64_t*)arr->data + arr->occupied, other->data,
+           count * sizeof(uint64_t));
+    break;
+  case DYN_ARRAY:
+    for (size_t i = 0; i < count; i += 1) {
+      dyn_array* el_copy = copy_dyn_array(((dyn_array**)other->data)[i]);
+      set_data_array_element(arr->data, el_copy, arr->occupied + i,
+                             arr->data_type);
+    }
+    break;
+  }
+  arr->occupied += count;
+  invalidate_hash_of_dyn_array(arr);
+}
+
+void reserve_dyn_array(dyn_array* arr, size_t capacity) {
+  // Enough that CAPACITY elements stay within the fill threshold.
+  size_t new_allocation_size = capacity / arr->fill_threshold;
+  while (new_allocation_size * arr->fill_threshold < capacity) {
+    new_allocation_size += 1;
+  }
+
+  if (new_allocation_size > arr->allocated) {
+    reallocate_dyn_array(arr, new_allocation_size);
+  }
+}
+
+void shrink_dyn_array_to_fit(dyn_array* arr) {
+  if (arr->allocated > arr->occupied) {
+    reallocate_dyn_array(arr, arr->occupied);
+  }
+}
+
+void set_growth_policy_of_dyn_array(dyn_array* arr, double growth_factor,
+                                    double fill_threshold) {
+  assert(growth_factor > 1.0);
+  assert(fill_threshold > 0.0 && fill_threshold <= 1.0);
+
+  arr->growth_factor  = growth_factor;
+  arr->fill_threshold = fill_threshold;
+}
+
+// Free the element at IDX of ARR, which is about to be removed.
+void free_element_of_dyn_array(dyn_array* arr, size_t idx) {
+  void (*freer)(const void* v) = freer_for_data_type(arr->data_type);
+  void* el                     = get_element_of_dyn_array(arr, idx);
+  if (el != NULL) {
+    freer(el);
+  }
+}
+
+// Move COUNT elements of ARR from index FROM to index TO.
+void move_elements_of_dyn_array(dyn_array* arr, size_t to, size_t from,
+                                size_t count) {
+  size_t el_size = size_of_data_type(arr->data_type);
+  memmove((char*)arr->data + to * el_size, (char*)arr->data + from * el_size,
+          count * el_size);
+}
+
 bool remove_element_of_dyn_array(dyn_array* arr, size_t idx) {
+  return erase_range_of_dyn_array(arr, idx, idx + 1) == 1;
+}
+
+bool swap_remove_element_of_dyn_array(dyn_array* arr, size_t idx) {
   if (idx >= arr->occupied) {
     return false;
   } else {
-    size_t end = arr->occupied;
-    for (size_t i = idx; i < end; i += 1) {
-      switch (arr->data_type) {
-      case UINT64:
-        ((uint64_t*)arr->data)[i] = ((uint64_t*)arr->data)[i + 1];
-      case DYN_ARRAY:
-        ((dyn_array**)arr->data)[i] = ((dyn_array**)arr->data)[i + 1];
-      }
-    }
+    free_element_of_dyn_array(arr, idx);
+    move_elements_of_dyn_array(arr, idx, arr->occupied - 1, 1);
     arr->occupied -= 1;
+    invalidate_hash_of_dyn_array(arr);
     return true;
   }
 }
 
+size_t erase_range_of_dyn_array(dyn_array* arr, size_t begin, size_t end) {
+  if (end > arr->occupied) {
+    end = arr->occupied;
+  }
+  if (begin >= end) {
+    return 0;
+  }
+
+  for (size_t i = begin; i < end; i += 1) {
+    free_element_of_dyn_array(arr, i);
+  }
+
+  // Close the gap with a single move of the tail.
+  move_elements_of_dyn_array(arr, begin, end, arr->occupied - end);
+  arr->occupied -= end - begin;
+  invalidate_hash_of_dyn_array(arr);
+  return end - begin;
+}
+
+size_t erase_indices_of_dyn_array(dyn_array* arr, dyn_array* indices) {
+  assert(indices->data_type == UINT64);
+  uint64_t* to_erase = (uint64_t*)indices->data;
+
+  // Walk the array once, moving each run of kept elements down over
+  // the gaps left by those erased so far.
+  size_t kept_end = 0; // End of the compacted, kept elements.
+  size_t next     = 0; // Next element not yet kept or erased.
+  for (size_t i = 0; i < indices->occupied; i += 1) {
+    size_t idx = to_erase[i];
+    if (idx >= arr->occupied) {
+      break;
+    }
+    if (idx < next) {
+      // Repeated index.
+      continue;
+    }
+
+    move_elements_of_dyn_array(arr, kept_end, next, idx - next);
+    kept_end += idx - next;
+
+    free_element_of_dyn_array(arr, idx);
+    next = idx + 1;
+  }
+  move_elements_of_dyn_array(arr, kept_end, next, arr->occupied - next);
+  kept_end += arr->occupied - next;
+
+  size_t removed = arr->occupied - kept_end;
+  arr->occupied  = kept_end;
+  invalidate_hash_of_dyn_array(arr);
+  return removed;
+}
+
+size_t erase_if_in_dyn_array(dyn_array* arr,
+                             bool (*predicate)(const void* el, void* context),
+                             void* context) {
+  size_t kept_end = 0;
+  for (size_t i = 0; i < arr->occupied; i += 1) {
+    void* el = get_element_of_dyn_array(arr, i);
+    if (predicate(el, context)) {
+      free_element_of_dyn_array(arr, i);
+    } else {
+      if (kept_end != i) {
+        move_elements_of_dyn_array(arr, kept_end, i, 1);
+      }
+      kept_end += 1;
+    }
+  }
+
+  size_t removed = arr->occupied - kept_end;
+  arr->occupied  = kept_end;
+  invalidate_hash_of_dyn_array(arr);
+  return removed;
+}
+
 void sort_dyn_array(dyn_array* arr) {
   // Simply sorting the contents as they are now.
   void* to_be_sorted = arr->data;
@@ -142,6 +317,7 @@ void sort_dyn_array(dyn_array* arr) {
       comparator_for_data_type(arr->data_type);
 
   qsort(to_be_sorted, num_things, thing_size, comparator);
+  invalidate_hash_of_dyn_array(arr);
 }
 
 dyn_array* sorted_dyn_array(dyn_array* arr) {
@@ -150,66 +326,104 @@ dyn_array* sorted_dyn_array(dyn_array* arr) {
   return sorted;
 }
 
-char* pp_dyn_array(dyn_array* arr) {
-  if (arr->occupied == 0) {
-    // Base case is easier to do manually with none of the other
-    // assumptions.
-    char* pp_string = malloc(3 * sizeof(char));
-    pp_string[0]    = '[';
-    pp_string[1]    = ']';
-    pp_string[2]    = '\0';
-    return pp_string;
-  } else {
-    // The pretty printer for the elements.
-    char* (*p_printer)(const void*) = pp_for_data_type(arr->data_type);
-
-    // Initialize with enough space for the static initial character
-    // and terminal - to make a well-behaved string. It will be
-    // re-allocated for elements.
-    char* pp_string = malloc(2 * sizeof(char));
-    pp_string[0]    = '[';
-    pp_string[1]    = '\0';
-
-    for (int i = 0; i < arr->occupied; i += 1) {
-      // A string just containing this element's printed representation.
-      char* pp_el = p_printer(get_element_of_dyn_array(arr, i));
-
-      // Length of that representation.
-      size_t pp_el_len = strlen(pp_el);
-
-      // Allocate space for this element and its ", " separator (plus
-      // the \0 terminator).
-      size_t new_length = (strlen(pp_string) + pp_el_len + 2 + 1);
-      pp_string         = realloc(pp_string, new_length * sizeof(char));
-
-      // Copy the representation into the buffer, free the source.
-      pp_string = strcat(pp_string, pp_el);
-      free(pp_el);
-
-      // Add element separator into the unused space at the end of the
-      // allocation, preserving the string terminal.
-      pp_string[new_length - 3] = ',';
-      pp_string[new_length - 2] = ' ';
-      pp_string[new_length - 1] = '\0';
+#define HASH_MULTIPLIER 0x9e3779b97f4a7c15UL
+
+// Return V thoroughly mixed - the finalizer of MurmurHash3. Tables
+// index by the low bits of a hash, which must depend on every element.
+static uint64_t mix_hash(uint64_t v) {
+  v ^= v >> 33;
+  v *= 0xff51afd7ed558ccdUL;
+  v ^= v >> 33;
+  v *= 0xc4ceb9fe1a85ec53UL;
+  v ^= v >> 33;
+  return v;
+}
+
+uint64_t hash_of_dyn_array(dyn_array* arr) {
+  if (arr->hash_valid) {
+    return arr->hash;
+  }
+
+  uint64_t hash = arr->data_type * HASH_MULTIPLIER + arr->occupied;
+  switch (arr->data_type) {
+  case UINT64: {
+    const uint64_t* values = arr->data;
+    for (size_t i = 0; i < arr->occupied; i += 1) {
+      hash = (hash ^ values[i]) * HASH_MULTIPLIER;
+      hash ^= hash >> 32;
+    }
+    break;
+  }
+  case DYN_ARRAY: {
+    // The element arrays may change without this one knowing, so only
+    // their hashes are kept.
+    dyn_array** elements = arr->data;
+    for (size_t i = 0; i < arr->occupied; i += 1) {
+      hash = (hash ^ hash_of_dyn_array(elements[i])) * HASH_MULTIPLIER;
+      hash ^= hash >> 32;
     }
+    return mix_hash(hash);
+  }
+  }
 
-    // Terminate the array, removing the extraneous element separator,
-    // and preserve the string terminal.
-    size_t pre_cut_length         = strlen(pp_string);
-    pp_string[pre_cut_length - 2] = ']';
-    pp_string[pre_cut_length - 1] = '\0';
+  arr->hash       = mix_hash(hash);
+  arr->hash_valid = true;
+  return arr->hash;
+}
 
-    size_t final_length = strlen(pp_string);
+void invalidate_hash_of_dyn_array(dyn_array* arr) {
+  arr->hash_valid = false;
+}
 
-    // Shrink the allocated string down to the required size.
-    pp_string = realloc(pp_string, (final_length + 1) * sizeof(char));
+bool equal_dyn_arrays(dyn_array* a, dyn_array* b) {
+  if (a == b) {
+    return true;
+  }
+  if (a->data_type != b->data_type || a->occupied != b->occupied ||
+      (a->hash_valid && b->hash_valid && a->hash != b->hash)) {
+    return false;
+  }
 
-    return pp_string;
+  switch (a->data_type) {
+  case UINT64:
+    return memcmp(a->data, b->data, a->occupied * sizeof(uint64_t)) == 0;
+  case DYN_ARRAY:
+    for (size_t i = 0; i < a->occupied; i += 1) {
+      if (!equal_dyn_arrays(((dyn_array**)a->data)[i],
+                            ((dyn_array**)b->data)[i])) {
+        return false;
+      }
+    }
+    return true;
+  }
+  printf("The C type system has been defeated.");
+  exit(-1);
+}
+
+void write_dyn_array(text_writer* writer, dyn_array* arr) {
+  void (*write_element)(text_writer*, const void*) =
+      writer_for_data_type(arr->data_type);
+
+  write_char(writer, '[');
+  for (size_t i = 0; i < arr->occupied; i += 1) {
+    if (i > 0) {
+      write_text(writer, ", ", 2);
+    }
+    write_element(writer, get_element_of_dyn_array(arr, i));
   }
+  write_char(writer, ']');
+}
+
+char* pp_dyn_array(dyn_array* arr) {
+  text_writer* writer = init_string_writer();
+  write_dyn_array(writer, arr);
+  return finish_string_writer(writer);
 }
 
 void print_dyn_array(dyn_array* arr) {
-  char* pp = pp_dyn_array((void*)arr);
-  printf("arr: %s\n", pp);
-  free(pp);
+  text_writer* writer = init_file_writer(stdout);
+  write_text(writer, "arr: ", 5);
+  write_dyn_array(writer, arr);
+  write_char(writer, '\n');
+  free_text_writer(writer);
 }
@@ -2,17 +2,27 @@
 #define DYN_ARRAY_H
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
 
 #include "./data.h"
 
 #define DYN_ARRAY_INIT_SIZE 10
 
+// Default growth policy: grow by this factor once full.
+#define DYN_ARRAY_GROWTH_FACTOR 2.0
+#define DYN_ARRAY_FILL_THRESHOLD 1.0
+
 typedef struct {
   data_type_t data_type; // Type of data elements.
   void* data;            // Actual content.
   size_t occupied;       // How much of the data array is populated.
   size_t allocated;      // Actual size of the data array.
+  double growth_factor;  // How much larger the data array gets on growth.
+  double fill_threshold; // Fraction of the data array which may be
+                         // populated before it must grow.
+  uint64_t hash;         // Hash of the contents, if hash_valid.
+  bool hash_valid;       // Whether hash is up to date.
 } dyn_array;
 
 // Initialize a dynamic array of the given TYPE.
@@ -31,9 +41,51 @@ void* get_element_of_dyn_array(dyn_array* arr, size_t idx);
 // NOTE: EL must be of the same data type as underlies ARR.
 void push_onto_dyn_array(dyn_array* arr, const void* el);
 
+// Insert copies of the COUNT VALUES onto the end of the UINT64 dynamic
+// array ARR.
+void append_uint64s_onto_dyn_array(dyn_array* arr, const uint64_t* values,
+                                   size_t count);
+
+// Insert copies of the elements of OTHER onto the end of ARR. Both
+// must be of the same data type.
+void append_dyn_array_onto_dyn_array(dyn_array* arr, dyn_array* other);
+
+// Make room in ARR for at least CAPACITY elements in total, so that
+// pushing up to that many does not re-allocate.
+void reserve_dyn_array(dyn_array* arr, size_t capacity);
+
+// Shrink the data array of ARR down to the elements it holds.
+void shrink_dyn_array_to_fit(dyn_array* arr);
+
+// Set how ARR grows: once more than FILL_THRESHOLD (in (0, 1]) of its
+// data array is populated, the data array gets GROWTH_FACTOR (> 1)
+// times larger.
+void set_growth_policy_of_dyn_array(dyn_array* arr, double growth_factor,
+                                    double fill_threshold);
+
 // Remove the element at the given IDX from the given ARR.
 bool remove_element_of_dyn_array(dyn_array* arr, size_t idx);
 
+// Remove the element at the given IDX from the given ARR by moving the
+// last element into its place - constant time, but not order-preserving.
+bool swap_remove_element_of_dyn_array(dyn_array* arr, size_t idx);
+
+// Remove the elements at indices [BEGIN, END) from the given ARR -
+// return how many were removed.
+size_t erase_range_of_dyn_array(dyn_array* arr, size_t begin, size_t end);
+
+// Remove the elements at the ascending UINT64 INDICES from the given
+// ARR in one pass - return how many were removed. Repeated and
+// out-of-range indices are ignored.
+size_t erase_indices_of_dyn_array(dyn_array* arr, dyn_array* indices);
+
+// Remove every element EL of the given ARR for which PREDICATE(EL,
+// CONTEXT) holds in one pass, preserving the order of the rest -
+// return how many were removed.
+size_t erase_if_in_dyn_array(dyn_array* arr,
+                             bool (*predicate)(const void* el, void* context),
+                             void* context);
+
 // Sort the contents of the given dynamic array ARR in place.
 void sort_dyn_array(dyn_array* arr);
 
@@ -41,6 +93,21 @@ void sort_dyn_array(dyn_array* arr);
 // ARR, but sorted.
 dyn_array* sorted_dyn_array(dyn_array* arr);
 
+// Return a hash of the contents of ARR - its type, length and elements
+// - so that arrays with equal contents hash alike. The hash of a UINT64
+// array is kept until it is next changed through these functions; one
+// of arrays is combined from the (kept) hashes of its elements.
+uint64_t hash_of_dyn_array(dyn_array* arr);
+
+// Forget the kept hash of ARR, after changing its data array directly.
+void invalidate_hash_of_dyn_array(dyn_array* arr);
+
+// Return whether A and B hold equal contents, element by element.
+bool equal_dyn_arrays(dyn_array* a, dyn_array* b);
+
+// Write the representation of the given dynamic array ARR to WRITER.
+void write_dyn_array(text_writer* writer, dyn_array* arr);
+
 // Return a string representing the given dynamic array ARR.
 char* pp_dyn_array(dyn_array* arr);
 
@@ -4,12 +4,33 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "./alloc_accounting.h"
+#include "./handler.h"
+#include "./timing.h"
+
 // Starting length of error message buffers, which will be reallocated
 // at error-creation time if more space is needed.
 #define ERROR_LENGTH 30
 
+static _Thread_local const char* current_path = NULL;
+static _Thread_local FILE* current_output     = NULL;
+
+const char* current_input_file_path() {
+  return current_path;
+}
+
+FILE* current_output_file() {
+  return (current_output != NULL) ? current_output : stdout;
+}
+
 int input_file_handler(char* input_file_path,
                        int (*continuation)(FILE* input_file)) {
+  return input_file_handler_with_output(input_file_path, stdout,
+                                        continuation);
+}
+
+int input_file_handler_with_output(char* input_file_path, FILE* output_file,
+                                   int (*continuation)(FILE* input_file)) {
   FILE* input_file = fopen(input_file_path, "r");
   if (input_file == NULL) {
     // Display an error message and return the appropriate error code.
@@ -30,6 +51,17 @@ int input_file_handler(char* input_file_path,
     free(error_message);
     return errno;
   } else {
-    return continuation(input_file);
+    // A thread waiting on a parallel loop may run another continuation
+    // inline, so restore rather than clear the previous ones.
+    const char* outer_path = current_path;
+    FILE* outer_output     = current_output;
+    current_path           = input_file_path;
+    current_output         = output_file;
+    begin_phase("solve");
+    int result = continuation(input_file);
+    end_phase();
+    current_path   = outer_path;
+    current_output = outer_output;
+    return result;
   }
 }
@@ -2,3 +2,16 @@
 
 int input_file_handler(char* input_file_path,
                        int (*continuation)(FILE* input_file));
+
+// As input_file_handler, with the continuation's answers written to
+// OUTPUT_FILE rather than stdout.
+int input_file_handler_with_output(char* input_file_path, FILE* output_file,
+                                   int (*continuation)(FILE* input_file));
+
+// Return the path of the input file the current thread's continuation
+// was called with, or NULL outside of one.
+const char* current_input_file_path();
+
+// Return the stream the current thread's continuation should write its
+// answers to - stdout unless the handler was given another.
+FILE* current_output_file();
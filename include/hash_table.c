@@ -2,17 +2,66 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
 
+#include "./alloc_accounting.h"
 #include "./data.h"
 #include "./hash_table.h"
 
+#ifdef HASH_TABLE_STATS
+// Only run STATEMENT when keeping stats.
+#define STAT(statement) statement
+
+// Record a lookup in TABLE which started at IDEAL_INDEX and stopped at
+// IDX, finding its key or not (HIT).
+static void record_lookup(hash_table* table, size_t ideal_index, size_t idx,
+                          bool hit) {
+  size_t bucket = (idx - ideal_index) & (table->allocated - 1);
+  if (bucket >= HASH_TABLE_HISTOGRAM_BUCKETS) {
+    bucket = HASH_TABLE_HISTOGRAM_BUCKETS - 1;
+  }
+  table->stats.probe_lengths[bucket] += 1;
+  if (hit) {
+    table->stats.hits += 1;
+  } else {
+    table->stats.misses += 1;
+  }
+}
+
+static uint64_t monotonic_ns() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+#else
+#define STAT(statement)
+#endif
+
+// Return the number of entries needed to hold CAPACITY keys - always a
+// power of two, so hashes can be masked into indices.
+size_t allocation_for_capacity(size_t capacity) {
+  size_t allocation = HASH_TABLE_INIT_SIZE;
+  while (capacity > allocation / HASH_TABLE_GROW_LOAD) {
+    allocation *= 2;
+  }
+  return allocation;
+}
+
 hash_table* init_hash_table(data_type_t key_type, data_type_t value_type) {
+  return init_hash_table_with_capacity(key_type, value_type, 0);
+}
+
+hash_table* init_hash_table_with_capacity(data_type_t key_type,
+                                          data_type_t value_type,
+                                          size_t capacity) {
   hash_table* table = malloc(sizeof(hash_table));
 
   table->key_type   = key_type;
   table->value_type = value_type;
   table->occupied   = 0;
-  table->allocated  = HASH_TABLE_INIT_SIZE;
+  table->allocated  = allocation_for_capacity(capacity);
+  table->reserved   = capacity;
+  STAT(memset(&table->stats, 0, sizeof(hash_table_stats)));
 
   // Zero out the entries array - important.
   table->entries = calloc(table->allocated, sizeof(hash_table_entry));
@@ -21,14 +70,16 @@ hash_table* init_hash_table(data_type_t key_type, data_type_t value_type) {
 }
 
 void free_table_entries(hash_table_entry* entries, size_t num_entries,
-                        data_type_t value_type) {
-  void (*freer)(const void* v) = freer_for_data_type(value_type);
+                        data_type_t key_type, data_type_t value_type) {
+  void (*key_freer)(const void* v) = freer_for_data_type(key_type);
+  void (*freer)(const void* v)     = freer_for_data_type(value_type);
 
-  // The values themselves may be allocated and need freeing.
+  // The keys and values themselves may be allocated and need freeing.
   for (int i = 0; i < num_entries; i += 1) {
     hash_table_entry entry = entries[i];
 
     if (entry.key != NULL) {
+      key_freer(entry.key);
       freer((void*)entry.value);
     }
   }
@@ -37,10 +88,19 @@ void free_table_entries(hash_table_entry* entries, size_t num_entries,
 }
 
 void free_hash_table(hash_table* table) {
-  free_table_entries(table->entries, table->allocated, table->value_type);
+  free_table_entries(table->entries, table->allocated, table->key_type,
+                     table->value_type);
   free(table);
 }
 
+// Return whether the stored KEY_A and KEY_B, of KEY_TYPE, are the same
+// key. Raw keys need no call to tell.
+static inline bool keys_match(data_type_t key_type, const void* key_a,
+                              const void* key_b) {
+  return key_a == key_b ||
+         (key_type != UINT64 && equality_for_data_type(key_type)(key_a, key_b));
+}
+
 void* get_entry_in_hash_table(hash_table* table, const void* key) {
   if (key == NULL) {
     return NULL;
@@ -58,14 +118,18 @@ void* get_entry_in_hash_table(hash_table* table, const void* key) {
   // list is never full.
   size_t idx = ideal_index;
   while (table->entries[idx].key != NULL) {
-    if (table->entries[idx].key == key) {
+    if (keys_match(table->key_type, table->entries[idx].key, key)) {
+      STAT(record_lookup(table, ideal_index, idx, true));
       return table->entries[idx].value;
     }
 
     // If the entry we are search for is "farther from home" than the
     // current entry, we know what we are looking for is not in the
     // table.
-    if ((idx - ideal_index) > table->entries[idx].displacement) {
+    // The distance is masked as the probe may have wrapped around.
+    size_t distance = (idx - ideal_index) & (table->allocated - 1);
+    if (distance > table->entries[idx].displacement) {
+      STAT(record_lookup(table, ideal_index, idx, false));
       return NULL;
     }
 
@@ -77,22 +141,19 @@ void* get_entry_in_hash_table(hash_table* table, const void* key) {
     }
   }
 
+  STAT(record_lookup(table, ideal_index, idx, false));
   return NULL;
 }
 
+// Place KEY with VALUE, which the entries now own, into ENTRIES. A new
+// key is copied in when counting it into OCCUPIED - otherwise the key
+// is already owned, and only moving.
 void set_entry(hash_table_entry* entries, size_t num_entries, const void* key,
                void* value, size_t* occupied, data_type_t key_type,
                data_type_t value_type) {
-  if (key == NULL) {
-    return;
-  }
-
   uint64_t (*hasher)(const void*) = hasher_for_data_type(key_type);
   uint64_t hash                   = hasher(key);
 
-  void* (*copier)(const void* v) = copier_for_data_type(value_type);
-  void* val_copy                 = copier(value);
-
   // The ideal index of this entry based on the key's hash.
   size_t ideal_index = (size_t)(hash & (uint64_t)(num_entries - 1));
 
@@ -101,11 +162,13 @@ void set_entry(hash_table_entry* entries, size_t num_entries, const void* key,
 
   // Key and value needing a home. Changes upon displacement.
   const void* homeless_key     = key;
-  void* homeless_val           = val_copy;
+  void* homeless_val           = value;
   size_t homeless_displacement = 0;
+  bool homeless_is_new         = occupied != NULL;
+  bool key_placed              = false;
 
   while (entries[idx].key != NULL) {
-    if (entries[idx].key == key) {
+    if (!key_placed && keys_match(key_type, entries[idx].key, key)) {
       // Found an already existing entry for this key, update the
       // value.
 
@@ -113,7 +176,7 @@ void set_entry(hash_table_entry* entries, size_t num_entries, const void* key,
       void (*freer)(const void* v) = freer_for_data_type(value_type);
       freer(entries[idx].value);
 
-      entries[idx].value = val_copy;
+      entries[idx].value = value;
       return;
     }
 
@@ -132,7 +195,12 @@ void set_entry(hash_table_entry* entries, size_t num_entries, const void* key,
       void* tmp_v       = entries[idx].value;
       size_t tmp_d      = entries[idx].displacement;
 
-      // Displace.
+      // Displace. Past this point KEY is known to be new.
+      key_placed = true;
+      if (homeless_is_new) {
+        homeless_key    = copier_for_data_type(key_type)(key);
+        homeless_is_new = false;
+      }
       entries[idx].key          = homeless_key;
       entries[idx].value        = homeless_val;
       entries[idx].displacement = homeless_displacement;
@@ -154,9 +222,12 @@ void set_entry(hash_table_entry* entries, size_t num_entries, const void* key,
 
   // If we make it here, there was no better place for this entry
   // in the robin hood system. Put it here.
+  if (homeless_is_new) {
+    homeless_key = copier_for_data_type(key_type)(key);
+  }
   entries[idx].key          = homeless_key;
   entries[idx].value        = homeless_val;
-  entries[idx].displacement = idx - ideal_index;
+  entries[idx].displacement = homeless_displacement;
 
   // 'occupied' is a passed-down pointer to a hash table's occupied
   // counter. If it is NULL then we are not meant to modify anything.
@@ -169,37 +240,73 @@ void set_entry(hash_table_entry* entries, size_t num_entries, const void* key,
   return;
 }
 
-void set_entry_in_hash_table(hash_table* table, const void* key, void* value) {
+// Move the entries of TABLE into a new entries array of NEW_ALLOCATION.
+void resize_hash_table(hash_table* table, size_t new_allocation) {
+  if (new_allocation == table->allocated) {
+    return;
+  }
 
-  if (table->occupied + 1 > (table->allocated / 2)) {
-    size_t new_allocation_size = 2 * table->allocated;
-    hash_table_entry* new_entries =
-        calloc(new_allocation_size, sizeof(hash_table_entry));
-
-    for (size_t i = 0; i < table->allocated; i += 1) {
-      hash_table_entry entry = table->entries[i];
-      // If this entry is set, then transfer it to the new place.
-      if (entry.key != NULL) {
-        set_entry(new_entries, new_allocation_size, entry.key, entry.value,
-                  NULL, table->key_type, table->value_type);
-      }
+  STAT(uint64_t start_ns = monotonic_ns());
+  hash_table_entry* new_entries =
+      calloc(new_allocation, sizeof(hash_table_entry));
+
+  for (size_t i = 0; i < table->allocated; i += 1) {
+    hash_table_entry entry = table->entries[i];
+    // If this entry is set, then transfer it to the new place. The
+    // value moves as-is, there is no need to copy it.
+    if (entry.key != NULL) {
+      set_entry(new_entries, new_allocation, entry.key, entry.value, NULL,
+                table->key_type, table->value_type);
     }
+  }
+
+  // Free only the old entries array, its values live on.
+  free(table->entries);
+
+  STAT(table->stats.rehash_ns += monotonic_ns() - start_ns);
+  STAT(if (new_allocation > table->allocated) table->stats.grows += 1;
+       else table->stats.shrinks += 1);
+
+  // Update the table's metadata.
+  table->entries   = new_entries;
+  table->allocated = new_allocation;
+}
+
+void reserve_hash_table(hash_table* table, size_t capacity) {
+  if (capacity > table->reserved) {
+    table->reserved = capacity;
+  }
 
-    // Free the old entries array.
-    free_table_entries(table->entries, table->allocated, table->value_type);
+  size_t new_allocation = allocation_for_capacity(capacity);
+  if (new_allocation > table->allocated) {
+    resize_hash_table(table, new_allocation);
+  }
+}
+
+void compact_hash_table(hash_table* table) {
+  table->reserved = 0;
+  resize_hash_table(table, allocation_for_capacity(table->occupied));
+}
 
-    // Update the table's metadata.
-    table->entries   = new_entries;
-    table->allocated = new_allocation_size;
+void set_entry_in_hash_table(hash_table* table, const void* key, void* value) {
+  if (key == NULL) {
+    return;
+  }
+
+  if (table->occupied + 1 > (table->allocated / HASH_TABLE_GROW_LOAD)) {
+    resize_hash_table(table, allocation_for_capacity(table->occupied + 1));
   }
 
-  set_entry(table->entries, table->allocated, key, value, &table->occupied,
-            table->key_type, table->value_type);
+  STAT(size_t occupied_before = table->occupied);
+  void* (*copier)(const void* v) = copier_for_data_type(table->value_type);
+  set_entry(table->entries, table->allocated, key, copier(value),
+            &table->occupied, table->key_type, table->value_type);
+  STAT(if (table->occupied > occupied_before) table->stats.inserts += 1;
+       else table->stats.updates += 1);
   return;
 }
 
 bool remove_entry_in_hash_table(hash_table* table, const void* key) {
-  // TODO could re-allocate to be smaller.
   if (key == NULL) {
     return false;
   }
@@ -217,14 +324,16 @@ bool remove_entry_in_hash_table(hash_table* table, const void* key) {
   size_t idx    = ideal_index;
   bool found_it = false;
   while (table->entries[idx].key != NULL) {
-    if (table->entries[idx].key == key) {
-      // Delete entry by marking NULL and freeing the value.
+    if (keys_match(table->key_type, table->entries[idx].key, key)) {
+      // Delete entry by marking NULL and freeing the key and value.
+      freer_for_data_type(table->key_type)(table->entries[idx].key);
       table->entries[idx].key      = NULL;
       void (*freer)(const void* v) = freer_for_data_type(table->value_type);
       freer(table->entries[idx].value);
 
       // Decrement the number of occupied entries.
       table->occupied -= 1;
+      STAT(table->stats.removes += 1);
 
       // Signal to move into backwards shifting.
       found_it = true;
@@ -244,7 +353,7 @@ bool remove_entry_in_hash_table(hash_table* table, const void* key) {
   if (found_it) {
     size_t empty_space_idx = idx;
     size_t backshift_candidate_idx;
-    if (idx >= table->allocated) {
+    if (idx + 1 >= table->allocated) {
       backshift_candidate_idx = 0;
     } else {
       backshift_candidate_idx = idx + 1;
@@ -276,6 +385,16 @@ bool remove_entry_in_hash_table(hash_table* table, const void* key) {
       }
     }
 
+    // Shrink once sparse enough, leaving room for the key count to
+    // double again.
+    if (table->occupied < table->allocated / HASH_TABLE_SHRINK_LOAD) {
+      size_t capacity = HASH_TABLE_GROW_LOAD * table->occupied;
+      if (capacity < table->reserved) {
+        capacity = table->reserved;
+      }
+      resize_hash_table(table, allocation_for_capacity(capacity));
+    }
+
     return true;
   } else {
 
@@ -283,82 +402,173 @@ bool remove_entry_in_hash_table(hash_table* table, const void* key) {
   }
 }
 
-char* pp_hash_table(hash_table* table) {
+void write_hash_table(text_writer* writer, hash_table* table) {
   if (table->occupied == 0) {
-    char* pp_string = malloc(4 * sizeof(char));
-    pp_string[0]    = '{';
-    pp_string[1]    = ' ';
-    pp_string[2]    = '}';
-    pp_string[3]    = '\0';
+    write_text(writer, "{ }", 3);
+    return;
+  }
 
-    return pp_string;
-  } else {
-    // The pretty printer for the elements.
-    char* (*key_pp_printer)(const void*) = pp_for_data_type(table->key_type);
-    char* (*value_pp_printer)(const void*) =
-        pp_for_data_type(table->value_type);
-
-    // Initialize with enough space for the static initial character
-    // and terminal - to make a well-behaved string. It will be
-    // re-allocated for elements.
-    char* pp_string = malloc(2 * sizeof(char));
-    pp_string[0]    = '{';
-    pp_string[1]    = '\0';
-
-    for (int i = 0; i < table->allocated; i += 1) {
-      hash_table_entry entry = table->entries[i];
-      // If this entry is set, then transfer it to the new place.
-
-      if (entry.key != NULL) {
-        char* pp_key   = key_pp_printer(entry.key);
-        char* pp_value = value_pp_printer(entry.value);
-
-        size_t pp_key_len   = strlen(pp_key);
-        size_t pp_value_len = strlen(pp_value);
-
-        // Allocate space for the key and the ": " separator (plus the
-        // \0 terminator).
-        size_t new_length = (strlen(pp_string) + pp_key_len + 2 + 1);
-        pp_string         = realloc(pp_string, new_length * sizeof(char));
-
-        // Copy the representation into the buffer, free the source.
-        pp_string = strcat(pp_string, pp_key);
-        free(pp_key);
-
-        pp_string[new_length - 3] = ':';
-        pp_string[new_length - 2] = ' ';
-        pp_string[new_length - 1] = '\0';
-
-        new_length = (strlen(pp_string) + pp_value_len + 2 + 1);
-        pp_string  = realloc(pp_string, new_length * sizeof(char));
-
-        pp_string = strcat(pp_string, pp_value);
-        free(pp_value);
-
-        pp_string[new_length - 3] = ',';
-        pp_string[new_length - 2] = ' ';
-        pp_string[new_length - 1] = '\0';
+  void (*write_key)(text_writer*, const void*) =
+      writer_for_data_type(table->key_type);
+  void (*write_value)(text_writer*, const void*) =
+      writer_for_data_type(table->value_type);
+
+  write_char(writer, '{');
+  bool first = true;
+  for (size_t i = 0; i < table->allocated; i += 1) {
+    hash_table_entry entry = table->entries[i];
+    if (entry.key != NULL) {
+      if (!first) {
+        write_text(writer, ", ", 2);
       }
+      first = false;
+
+      write_key(writer, entry.key);
+      write_text(writer, ": ", 2);
+      write_value(writer, entry.value);
     }
+  }
+  write_char(writer, '}');
+}
 
-    // Terminate the array, removing the extraneous element separator,
-    // and preserve the string terminal.
-    size_t pre_cut_length         = strlen(pp_string);
-    pp_string[pre_cut_length - 2] = '}';
-    pp_string[pre_cut_length - 1] = '\0';
+char* pp_hash_table(hash_table* table) {
+  text_writer* writer = init_string_writer();
+  write_hash_table(writer, table);
+  return finish_string_writer(writer);
+}
 
-    size_t final_length = strlen(pp_string);
+void print_hash_table(hash_table* table) {
+  text_writer* writer = init_file_writer(stdout);
+  write_text(writer, "table: ", 7);
+  write_hash_table(writer, table);
+  write_char(writer, '\n');
+  free_text_writer(writer);
+}
 
-    // Shrink the allocated string down to the required size.
-    pp_string = realloc(pp_string, (final_length + 1) * sizeof(char));
+// Fill the HISTOGRAM of TABLE's entry displacements, and return the
+// largest.
+size_t displacement_histogram(hash_table* table, uint64_t* histogram) {
+  memset(histogram, 0, HASH_TABLE_HISTOGRAM_BUCKETS * sizeof(uint64_t));
+  size_t max = 0;
+  for (size_t i = 0; i < table->allocated; i += 1) {
+    if (table->entries[i].key != NULL) {
+      size_t displacement = table->entries[i].displacement;
+      if (displacement > max) {
+        max = displacement;
+      }
+      if (displacement >= HASH_TABLE_HISTOGRAM_BUCKETS) {
+        displacement = HASH_TABLE_HISTOGRAM_BUCKETS - 1;
+      }
+      histogram[displacement] += 1;
+    }
+  }
+  return max;
+}
 
-    return pp_string;
+// Return the mean of HISTOGRAM, counting the last bucket at its lower
+// bound.
+double mean_of_histogram(const uint64_t* histogram) {
+  uint64_t count = 0;
+  uint64_t total = 0;
+  for (size_t i = 0; i < HASH_TABLE_HISTOGRAM_BUCKETS; i += 1) {
+    count += histogram[i];
+    total += i * histogram[i];
   }
+  return count == 0 ? 0 : (double)total / count;
 }
 
-// Print the given hash table TABLE to stdout.
-void print_hash_table(hash_table* table) {
-  char* pp = pp_hash_table(table);
-  printf("table: %s\n", pp);
+// Print HISTOGRAM to OUT, as a JSON array if JSON.
+void print_histogram(FILE* out, const uint64_t* histogram, bool json) {
+  // Trailing empty buckets are left off.
+  size_t used = HASH_TABLE_HISTOGRAM_BUCKETS;
+  while (used > 0 && histogram[used - 1] == 0) {
+    used -= 1;
+  }
+
+  if (json) {
+    fprintf(out, "[");
+    for (size_t i = 0; i < used; i += 1) {
+      fprintf(out, i == 0 ? "%lu" : ", %lu", histogram[i]);
+    }
+    fprintf(out, "]");
+  } else {
+    for (size_t i = 0; i < used; i += 1) {
+      const char* sep = i + 1 == HASH_TABLE_HISTOGRAM_BUCKETS ? "+:" : ": ";
+      fprintf(out, "    %2lu%s %lu\n", i, sep, histogram[i]);
+    }
+  }
+}
+
+// Return the health report of TABLE, as JSON if JSON.
+char* report_of_hash_table_stats(hash_table* table, bool json) {
+  char* report;
+  size_t report_size;
+  FILE* out = open_memstream(&report, &report_size);
+
+  uint64_t displacements[HASH_TABLE_HISTOGRAM_BUCKETS];
+  size_t max_displacement  = displacement_histogram(table, displacements);
+  double mean_displacement = mean_of_histogram(displacements);
+  double load              = (double)table->occupied / table->allocated;
+
+  if (json) {
+    fprintf(out,
+            "{\"occupied\": %lu, \"allocated\": %lu, \"load\": %.4f, "
+            "\"max_displacement\": %lu, \"mean_displacement\": %.4f, "
+            "\"displacements\": ",
+            table->occupied, table->allocated, load, max_displacement,
+            mean_displacement);
+    print_histogram(out, displacements, true);
+  } else {
+    fprintf(out, "occupied: %lu / %lu (load %.3f)\n", table->occupied,
+            table->allocated, load);
+    fprintf(out, "displacement: max %lu, mean %.3f\n", max_displacement,
+            mean_displacement);
+    print_histogram(out, displacements, false);
+  }
+
+#ifdef HASH_TABLE_STATS
+  hash_table_stats* stats = &table->stats;
+  double mean_probes      = mean_of_histogram(stats->probe_lengths) + 1;
+  if (json) {
+    fprintf(out,
+            ", \"hits\": %lu, \"misses\": %lu, \"inserts\": %lu, "
+            "\"updates\": %lu, \"removes\": %lu, \"grows\": %lu, "
+            "\"shrinks\": %lu, \"rehash_ns\": %lu, "
+            "\"mean_probe_length\": %.4f, \"probe_lengths\": ",
+            stats->hits, stats->misses, stats->inserts, stats->updates,
+            stats->removes, stats->grows, stats->shrinks, stats->rehash_ns,
+            mean_probes);
+    print_histogram(out, stats->probe_lengths, true);
+  } else {
+    fprintf(out, "lookups: %lu hits, %lu misses\n", stats->hits,
+            stats->misses);
+    fprintf(out, "sets: %lu inserts, %lu updates - removes: %lu\n",
+            stats->inserts, stats->updates, stats->removes);
+    fprintf(out, "resizes: %lu grows, %lu shrinks, %.3f ms rehashing\n",
+            stats->grows, stats->shrinks, stats->rehash_ns / 1e6);
+    fprintf(out, "extra probes per lookup: mean %.3f\n", mean_probes - 1);
+    print_histogram(out, stats->probe_lengths, false);
+  }
+#endif
+
+  if (json) {
+    fprintf(out, "}");
+  }
+
+  fclose(out);
+  return report;
+}
+
+char* pp_hash_table_stats(hash_table* table) {
+  return report_of_hash_table_stats(table, false);
+}
+
+char* json_of_hash_table_stats(hash_table* table) {
+  return report_of_hash_table_stats(table, true);
+}
+
+void print_hash_table_stats(hash_table* table, const char* name) {
+  char* pp = pp_hash_table_stats(table);
+  fprintf(stderr, "hash table %s:\n%s", name, pp);
   free(pp);
 }
@@ -2,21 +2,53 @@
 #define HASH_TABLE_H
 
 #include <stdbool.h>
+#include <stdint.h>
 
 #include "data.h"
 
 #define HASH_TABLE_INIT_SIZE 16
 
+// Tables grow once more than 1/HASH_TABLE_GROW_LOAD of their entries
+// are occupied, and shrink once fewer than 1/HASH_TABLE_SHRINK_LOAD
+// are. Shrinking leaves room for the key count to double before the
+// next growth, so alternating sets and removes cannot thrash.
+#define HASH_TABLE_GROW_LOAD 2
+#define HASH_TABLE_SHRINK_LOAD 8
+
 // XXX: At the moment using NULL/0L as a key is unsupported. Such
 // entries will not be retrievable or free-able. A key scheme change
 // is required.
 
+// UINT64 keys are compared by value. DYN_ARRAY keys are compared by
+// contents, through their kept hashes, and are copied in like values -
+// a key must not change while it is being looked up.
+
 typedef struct {
   const void* key;     // If this entry is unassigned then key is NULL.
+                       // Copy-in, like the value.
   void* value;         // Copy-in, reference-out.
   size_t displacement; // This entry's distance from its hash-ideal index.
 } hash_table_entry;
 
+// Probe lengths (and displacements) are histogrammed into this many
+// buckets, the last collecting everything as long or longer.
+#define HASH_TABLE_HISTOGRAM_BUCKETS 32
+
+// Counters kept by tables when built with -DHASH_TABLE_STATS, which
+// otherwise cost nothing.
+typedef struct {
+  // Lookups by how many entries they examined past their ideal one.
+  uint64_t probe_lengths[HASH_TABLE_HISTOGRAM_BUCKETS];
+  uint64_t hits;      // Lookups finding their key.
+  uint64_t misses;    // Lookups not finding their key.
+  uint64_t inserts;   // Sets of a new key.
+  uint64_t updates;   // Sets of an existing key.
+  uint64_t removes;   // Successful removes.
+  uint64_t grows;     // Resizes to a larger entries array.
+  uint64_t shrinks;   // Resizes to a smaller entries array.
+  uint64_t rehash_ns; // Time spent moving entries during resizes.
+} hash_table_stats;
+
 typedef struct {
   data_type_t key_type;   // Type of keys (pre-hashing) in this table.
   data_type_t value_type; // Type of values in this table.
@@ -24,11 +56,30 @@ typedef struct {
   hash_table_entry* entries;
   size_t occupied;
   size_t allocated;
+  size_t reserved; // Key count the table will not shrink below.
+
+#ifdef HASH_TABLE_STATS
+  hash_table_stats stats;
+#endif
 } hash_table;
 
 // Initialize a hash table with KEY_TYPE and VALUE TYPE.
 hash_table* init_hash_table(data_type_t key_type, data_type_t value_type);
 
+// Initialize a hash table with KEY_TYPE and VALUE_TYPE which can hold
+// CAPACITY keys without resizing.
+hash_table* init_hash_table_with_capacity(data_type_t key_type,
+                                          data_type_t value_type,
+                                          size_t capacity);
+
+// Ensure the given TABLE can hold CAPACITY keys without resizing, and
+// does not automatically shrink below that.
+void reserve_hash_table(hash_table* table, size_t capacity);
+
+// Shrink the given TABLE to the smallest size holding its current
+// keys, dropping any reservation.
+void compact_hash_table(hash_table* table);
+
 // Free the given hash table TABLE.
 void free_hash_table(hash_table* table);
 
@@ -39,13 +90,27 @@ void* get_entry_in_hash_table(hash_table* table, const void* key);
 void set_entry_in_hash_table(hash_table* table, const void* key, void* value);
 
 // Remove the value associated with the given key in TABLE - return
-// whether operation succeeded.
+// whether operation succeeded. The table shrinks as its load drops.
 bool remove_entry_in_hash_table(hash_table* table, const void* key);
 
+// Write the representation of the given table TABLE to WRITER.
+void write_hash_table(text_writer* writer, hash_table* table);
+
 // Return a string representing the given table TABLE.
 char* pp_hash_table(hash_table* table);
 
 // Print the given hash table TABLE to stdout.
 void print_hash_table(hash_table* table);
 
+// Return a multi-line report on the health of TABLE: its load and
+// displacement distribution, plus its counters if built with
+// -DHASH_TABLE_STATS.
+char* pp_hash_table_stats(hash_table* table);
+
+// Return the report of pp_hash_table_stats as a JSON object.
+char* json_of_hash_table_stats(hash_table* table);
+
+// Print the health report of TABLE, labelled NAME, to stderr.
+void print_hash_table_stats(hash_table* table, const char* name);
+
 #endif
@@ -0,0 +1,110 @@
+#include <assert.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "./alloc_accounting.h"
+#include "./dyn_array.h"
+#include "./hyperloglog.h"
+
+// Values are hashed a block at a time, so the hashing loop has no
+// dependence on the registers and can be vectorized.
+#define HASH_BLOCK 64
+
+hyperloglog* init_hyperloglog(unsigned precision) {
+  assert(precision >= 4 && precision <= 18);
+
+  hyperloglog* hll   = malloc(sizeof(hyperloglog));
+  hll->precision     = precision;
+  hll->num_registers = (size_t)1 << precision;
+  hll->registers     = calloc(hll->num_registers, sizeof(uint8_t));
+  return hll;
+}
+
+void free_hyperloglog(hyperloglog* hll) {
+  free(hll->registers);
+  free(hll);
+}
+
+// Return a well-mixed 64-bit hash of V - the finalizer of MurmurHash3.
+// The tables' identity hash would leave the high bits of small values
+// all zero.
+static inline uint64_t mix_uint64(uint64_t v) {
+  v ^= v >> 33;
+  v *= 0xff51afd7ed558ccdUL;
+  v ^= v >> 33;
+  v *= 0xc4ceb9fe1a85ec53UL;
+  v ^= v >> 33;
+  return v;
+}
+
+void add_uint64s_to_hyperloglog(hyperloglog* hll, const uint64_t* values,
+                                size_t count) {
+  unsigned p = hll->precision;
+  uint64_t hashes[HASH_BLOCK];
+
+  for (size_t start = 0; start < count; start += HASH_BLOCK) {
+    size_t block = count - start < HASH_BLOCK ? count - start : HASH_BLOCK;
+
+    for (size_t i = 0; i < block; i += 1) {
+      hashes[i] = mix_uint64(values[start + i]);
+    }
+
+    // The top P bits pick a register, which keeps the longest run of
+    // leading zeroes (+ 1) seen in the remaining bits. A sentinel bit
+    // bounds the run when the remaining bits are all zero.
+    for (size_t i = 0; i < block; i += 1) {
+      size_t idx   = hashes[i] >> (64 - p);
+      uint64_t w   = (hashes[i] << p) | ((uint64_t)1 << (p - 1));
+      uint8_t rank = __builtin_clzll(w) + 1;
+      if (rank > hll->registers[idx]) {
+        hll->registers[idx] = rank;
+      }
+    }
+  }
+}
+
+void add_dyn_array_to_hyperloglog(hyperloglog* hll, dyn_array* arr) {
+  assert(arr->data_type == UINT64);
+  add_uint64s_to_hyperloglog(hll, (uint64_t*)arr->data, arr->occupied);
+}
+
+void merge_hyperloglogs(hyperloglog* into, hyperloglog* from) {
+  assert(into->precision == from->precision);
+  for (size_t i = 0; i < into->num_registers; i += 1) {
+    if (from->registers[i] > into->registers[i]) {
+      into->registers[i] = from->registers[i];
+    }
+  }
+}
+
+size_t estimate_of_hyperloglog(hyperloglog* hll) {
+  double m = hll->num_registers;
+
+  double sum         = 0;
+  size_t empty_count = 0;
+  for (size_t i = 0; i < hll->num_registers; i += 1) {
+    sum += ldexp(1.0, -hll->registers[i]);
+    empty_count += hll->registers[i] == 0;
+  }
+
+  // The harmonic mean of the registers, bias-corrected.
+  double alpha    = 0.7213 / (1 + 1.079 / m);
+  double estimate = alpha * m * m / sum;
+
+  // Small cardinalities are better estimated from how many registers
+  // are still empty (linear counting).
+  if (estimate <= 2.5 * m && empty_count > 0) {
+    estimate = m * log(m / empty_count);
+  }
+
+  return (size_t)(estimate + 0.5);
+}
+
+size_t estimate_distinct_in_dyn_array(dyn_array* arr) {
+  hyperloglog* hll = init_hyperloglog(HYPERLOGLOG_PRECISION);
+  add_dyn_array_to_hyperloglog(hll, arr);
+  size_t estimate = estimate_of_hyperloglog(hll);
+  free_hyperloglog(hll);
+  return estimate;
+}
@@ -0,0 +1,50 @@
+/*
+  A HyperLogLog sketch, estimating how many distinct raw uint64_t
+  values it has seen in a few KiB of registers, to within a couple of
+  percent. Good enough to size tables up front, or to choose between
+  hash-based and sort-based strategies.
+ */
+
+#ifndef HYPERLOGLOG_H
+#define HYPERLOGLOG_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "./dyn_array.h"
+
+// Default number of hash bits selecting a register - 2^12 registers
+// give a standard error of about 1.6%.
+#define HYPERLOGLOG_PRECISION 12
+
+typedef struct {
+  uint8_t* registers;   // Per register, the longest run of zeroes seen + 1.
+  size_t num_registers; // 2^precision.
+  unsigned precision;   // Number of hash bits selecting a register.
+} hyperloglog;
+
+// Initialize an empty sketch with 2^PRECISION registers.
+hyperloglog* init_hyperloglog(unsigned precision);
+
+// Free the given sketch HLL.
+void free_hyperloglog(hyperloglog* hll);
+
+// Add the COUNT VALUES to the given sketch HLL.
+void add_uint64s_to_hyperloglog(hyperloglog* hll, const uint64_t* values,
+                                size_t count);
+
+// Add the elements of the UINT64 dynamic array ARR to the given sketch HLL.
+void add_dyn_array_to_hyperloglog(hyperloglog* hll, dyn_array* arr);
+
+// Add everything seen by the sketch FROM to the sketch INTO, which must
+// have the same precision.
+void merge_hyperloglogs(hyperloglog* into, hyperloglog* from);
+
+// Return the estimated number of distinct values seen by HLL.
+size_t estimate_of_hyperloglog(hyperloglog* hll);
+
+// Return the estimated number of distinct elements of the UINT64
+// dynamic array ARR.
+size_t estimate_distinct_in_dyn_array(dyn_array* arr);
+
+#endif
@@ -0,0 +1,393 @@
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "./alloc_accounting.h"
+#include "./input_cache.h"
+
+#define CHECKSUM_PRIME 0x100000001b3UL
+
+// Mix the LENGTH bytes at DATA into the running checksum HASH. Whole
+// words at a time, since payloads can be gigabytes.
+uint64_t checksum_bytes(uint64_t hash, const void* data, size_t length) {
+  const unsigned char* bytes = data;
+
+  size_t i = 0;
+  for (; i + sizeof(uint64_t) <= length; i += sizeof(uint64_t)) {
+    uint64_t word;
+    memcpy(&word, bytes + i, sizeof(uint64_t));
+    hash = (hash ^ word) * CHECKSUM_PRIME;
+    hash ^= hash >> 29;
+  }
+  for (; i < length; i += 1) {
+    hash = (hash ^ bytes[i]) * CHECKSUM_PRIME;
+  }
+  return hash;
+}
+
+uint64_t checksum_of_header(input_cache_header* header) {
+  return checksum_bytes(0, header,
+                        offsetof(input_cache_header, header_checksum));
+}
+
+// Hash the first and last INPUT_CACHE_SAMPLE_SIZE bytes of the first
+// SIZE bytes of the input open at FD - which may be longer.
+uint64_t hash_of_input(int fd, uint64_t size) {
+  char* sample = malloc(INPUT_CACHE_SAMPLE_SIZE);
+
+  uint64_t hash = checksum_bytes(0, &size, sizeof(uint64_t));
+
+  size_t head = size < INPUT_CACHE_SAMPLE_SIZE ? size : INPUT_CACHE_SAMPLE_SIZE;
+  ssize_t got = pread(fd, sample, head, 0);
+  if (got > 0) {
+    hash = checksum_bytes(hash, sample, got);
+  }
+  if (size > INPUT_CACHE_SAMPLE_SIZE) {
+    got = pread(fd, sample, INPUT_CACHE_SAMPLE_SIZE,
+                size - INPUT_CACHE_SAMPLE_SIZE);
+    if (got > 0) {
+      hash = checksum_bytes(hash, sample, got);
+    }
+  }
+
+  free(sample);
+  return hash;
+}
+
+// Set HASH to the hash of all of the first SIZE bytes of the input
+// open at FD - which may be longer. Return whether they could be read.
+bool hash_of_prefix(int fd, uint64_t size, uint64_t* hash) {
+  *hash = checksum_bytes(0, &size, sizeof(uint64_t));
+  if (size == 0) {
+    return true;
+  }
+
+  void* mapping = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (mapping == MAP_FAILED) {
+    return false;
+  }
+  madvise(mapping, size, MADV_SEQUENTIAL);
+  *hash = checksum_bytes(*hash, mapping, size);
+  munmap(mapping, size);
+  return true;
+}
+
+// Fill in the input-describing fields of HEADER from the first SIZE
+// bytes of the input at INPUT_PATH, or all of it if it is no longer -
+// only hashing every byte given WHOLE. Return whether the input could
+// be inspected.
+bool describe_input(const char* input_path, uint64_t size,
+                    input_cache_header* header, bool whole) {
+  int fd = open(input_path, O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+    close(fd);
+    return false;
+  }
+
+  if (size > (uint64_t)st.st_size) {
+    size = st.st_size;
+  }
+  header->input_size       = size;
+  header->input_mtime_sec  = st.st_mtim.tv_sec;
+  header->input_mtime_nsec = st.st_mtim.tv_nsec;
+  header->input_hash       = hash_of_input(fd, size);
+  header->prefix_hash      = 0;
+
+  bool described = !whole || hash_of_prefix(fd, size, &header->prefix_hash);
+
+  close(fd);
+  return described;
+}
+
+// Return the newly-allocated path of the KIND cache of INPUT_PATH.
+char* cache_path(const char* input_path, const char* kind) {
+  size_t length = strlen(input_path) + strlen(kind) + strlen("..cache") + 1;
+  char* path    = malloc(length * sizeof(char));
+  snprintf(path, length, "%s.%s.cache", input_path, kind);
+  return path;
+}
+
+bool input_cache_enabled() {
+  char* enabled = getenv("AOC_INPUT_CACHE");
+  return enabled != NULL && strcmp(enabled, "1") == 0;
+}
+
+// Map the KIND cache of the input at INPUT_PATH with NUM_COLUMNS
+// columns per block, if there is one of the input as it is now - or,
+// given PREFIX, of the input as it was before anything was appended.
+input_cache* load_matching_input_cache(const char* input_path,
+                                       const char* kind, size_t num_columns,
+                                       bool prefix) {
+  if (!input_cache_enabled() || input_path == NULL) {
+    return NULL;
+  }
+
+  char* path = cache_path(input_path, kind);
+  int fd     = open(path, O_RDONLY);
+  free(path);
+  if (fd < 0) {
+    return NULL;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size < sizeof(input_cache_header)) {
+    close(fd);
+    return NULL;
+  }
+
+  // The single mmap - everything handed out afterwards points into it.
+  void* mapping = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (mapping == MAP_FAILED) {
+    return NULL;
+  }
+
+  input_cache* cache  = calloc(1, sizeof(input_cache));
+  cache->mapping      = mapping;
+  cache->mapping_size = st.st_size;
+  cache->header       = mapping;
+
+  input_cache_header* header = cache->header;
+  input_cache_header current;
+  bool valid = header->magic == INPUT_CACHE_MAGIC &&
+               header->version == INPUT_CACHE_VERSION &&
+               header->header_checksum == checksum_of_header(header) &&
+               strncmp(header->kind, kind, INPUT_CACHE_KIND_LENGTH) == 0 &&
+               header->num_columns == num_columns &&
+               num_columns <= INPUT_CACHE_MAX_COLUMNS;
+
+  // The input as it was is recognized by its size, modification time
+  // and the hash of its ends.
+  bool unchanged = valid &&
+                   describe_input(input_path, UINT64_MAX, &current, false) &&
+                   header->input_size == current.input_size &&
+                   header->input_mtime_sec == current.input_mtime_sec &&
+                   header->input_mtime_nsec == current.input_mtime_nsec &&
+                   header->input_hash == current.input_hash;
+
+  // Appended to since, it has to begin with every byte that was parsed -
+  // its ends alone would miss an edit in the middle.
+  if (valid && !unchanged) {
+    valid = prefix &&
+            describe_input(input_path, header->input_size, &current, true) &&
+            header->input_size == current.input_size &&
+            header->prefix_hash == current.prefix_hash;
+  }
+
+  // Find the blocks - per block, not per value, work.
+  if (valid) {
+    cache->num_blocks = header->num_blocks;
+    cache->blocks     = calloc(cache->num_blocks, sizeof(input_cache_block));
+
+    const uint64_t* cursor = (const uint64_t*)(header + 1);
+    const uint64_t* end =
+        (const uint64_t*)((char*)mapping + cache->mapping_size);
+    for (size_t b = 0; valid && b < cache->num_blocks; b += 1) {
+      for (size_t c = 0; c < num_columns; c += 1) {
+        if (cursor >= end || *cursor > (size_t)(end - cursor - 1)) {
+          valid = false;
+          break;
+        }
+        cache->blocks[b].lengths[c] = *cursor;
+        cache->blocks[b].columns[c] = cursor + 1;
+        cursor += 1 + *cursor;
+      }
+    }
+  }
+
+  if (!valid) {
+    free_input_cache(cache);
+    return NULL;
+  }
+  return cache;
+}
+
+input_cache* load_input_cache(const char* input_path, const char* kind,
+                              size_t num_columns) {
+  return load_matching_input_cache(input_path, kind, num_columns, false);
+}
+
+input_cache* load_input_cache_of_prefix(const char* input_path,
+                                        const char* kind,
+                                        size_t num_columns) {
+  return load_matching_input_cache(input_path, kind, num_columns, true);
+}
+
+void free_input_cache(input_cache* cache) {
+  munmap(cache->mapping, cache->mapping_size);
+  free(cache->blocks);
+  free(cache);
+}
+
+bool verify_input_cache(input_cache* cache) {
+  uint64_t checksum = 0;
+  for (size_t b = 0; b < cache->num_blocks; b += 1) {
+    for (size_t c = 0; c < cache->header->num_columns; c += 1) {
+      uint64_t length = cache->blocks[b].lengths[c];
+      checksum        = checksum_bytes(checksum, &length, sizeof(uint64_t));
+      checksum        = checksum_bytes(checksum, cache->blocks[b].columns[c],
+                                       length * sizeof(uint64_t));
+    }
+  }
+  return checksum == cache->header->payload_checksum;
+}
+
+input_cache_writer* init_input_cache_writer(const char* input_path,
+                                            const char* kind,
+                                            size_t num_columns) {
+  return init_input_cache_writer_of_prefix(input_path, kind, num_columns,
+                                           UINT64_MAX);
+}
+
+input_cache_writer* init_input_cache_writer_of_prefix(const char* input_path,
+                                                      const char* kind,
+                                                      size_t num_columns,
+                                                      uint64_t size) {
+  if (!input_cache_enabled() || input_path == NULL ||
+      num_columns > INPUT_CACHE_MAX_COLUMNS) {
+    return NULL;
+  }
+
+  input_cache_writer* writer = calloc(1, sizeof(input_cache_writer));
+  if (!describe_input(input_path, size, &writer->header, true)) {
+    free(writer);
+    return NULL;
+  }
+
+  writer->header.magic       = INPUT_CACHE_MAGIC;
+  writer->header.version     = INPUT_CACHE_VERSION;
+  writer->header.num_columns = num_columns;
+  // The kind is zero-padded, and unterminated if it fills the field.
+  memcpy(writer->header.kind, kind, strnlen(kind, INPUT_CACHE_KIND_LENGTH));
+
+  // Write to a temporary file and move it into place once complete, so
+  // a reader never maps a half-written cache.
+  writer->final_path     = cache_path(input_path, kind);
+  size_t length          = strlen(writer->final_path) + strlen(".XXXXXX") + 1;
+  writer->temporary_path = malloc(length * sizeof(char));
+  snprintf(writer->temporary_path, length, "%s.XXXXXX", writer->final_path);
+
+  int fd = mkstemp(writer->temporary_path);
+  if (fd < 0) {
+    free(writer->temporary_path);
+    free(writer->final_path);
+    free(writer);
+    return NULL;
+  }
+  writer->file = fdopen(fd, "w");
+
+  // Space for the header, which is only known at the end.
+  fwrite(&writer->header, sizeof(input_cache_header), 1, writer->file);
+
+  return writer;
+}
+
+// Return the offset in the mapping of CACHE just past its last block -
+// the end of the file, unless an unfinished append left more behind.
+size_t end_of_blocks(input_cache* cache) {
+  if (cache->num_blocks == 0) {
+    return sizeof(input_cache_header);
+  }
+  input_cache_block* last = &cache->blocks[cache->num_blocks - 1];
+  size_t num_columns      = cache->header->num_columns;
+  const uint64_t* end =
+      last->columns[num_columns - 1] + last->lengths[num_columns - 1];
+  return (const char*)end - (const char*)cache->mapping;
+}
+
+input_cache_writer* init_input_cache_appender(input_cache* cache,
+                                              const char* input_path,
+                                              const char* kind,
+                                              uint64_t size) {
+  if (!input_cache_enabled() || input_path == NULL) {
+    return NULL;
+  }
+
+  input_cache_writer* writer = calloc(1, sizeof(input_cache_writer));
+  writer->header             = *cache->header;
+  if (!describe_input(input_path, size, &writer->header, true)) {
+    free(writer);
+    return NULL;
+  }
+
+  // Only the file CACHE was mapped from can be appended to.
+  writer->final_path = cache_path(input_path, kind);
+  int fd             = open(writer->final_path, O_RDWR);
+  size_t end         = end_of_blocks(cache);
+  input_cache_header on_disk;
+  if (fd < 0 ||
+      pread(fd, &on_disk, sizeof(input_cache_header), 0) !=
+          sizeof(input_cache_header) ||
+      memcmp(&on_disk, cache->header, sizeof(input_cache_header)) != 0 ||
+      ftruncate(fd, end) != 0) {
+    if (fd >= 0) {
+      close(fd);
+    }
+    free(writer->final_path);
+    free(writer);
+    return NULL;
+  }
+
+  // The header is only rewritten once the new blocks are in place.
+  writer->file = fdopen(fd, "r+");
+  fseek(writer->file, end, SEEK_SET);
+  return writer;
+}
+
+void append_block_to_input_cache(input_cache_writer* writer,
+                                 const uint64_t** columns,
+                                 const size_t* lengths) {
+  uint64_t checksum = writer->header.payload_checksum;
+  for (size_t c = 0; c < writer->header.num_columns; c += 1) {
+    uint64_t length = lengths[c];
+    fwrite(&length, sizeof(uint64_t), 1, writer->file);
+    if (length > 0) {
+      // An empty column may have nothing to point at.
+      fwrite(columns[c], sizeof(uint64_t), length, writer->file);
+    }
+
+    checksum = checksum_bytes(checksum, &length, sizeof(uint64_t));
+    checksum =
+        checksum_bytes(checksum, columns[c], length * sizeof(uint64_t));
+  }
+  writer->header.payload_checksum = checksum;
+  writer->header.num_blocks += 1;
+}
+
+void finish_input_cache(input_cache_writer* writer) {
+  writer->header.header_checksum = checksum_of_header(&writer->header);
+
+  // The blocks go out before the header which counts them, so a cache
+  // appended to in place is never described past what it holds.
+  bool written = fflush(writer->file) == 0;
+  if (written) {
+    fseek(writer->file, 0, SEEK_SET);
+    fwrite(&writer->header, sizeof(input_cache_header), 1, writer->file);
+  }
+  written &= ferror(writer->file) == 0;
+  written &= fclose(writer->file) == 0;
+
+  if (writer->temporary_path != NULL) {
+    if (written) {
+      rename(writer->temporary_path, writer->final_path);
+    } else {
+      unlink(writer->temporary_path);
+    }
+  }
+
+  free(writer->temporary_path);
+  free(writer->final_path);
+  free(writer);
+}
@@ -0,0 +1,131 @@
+/*
+  A binary cache of parsed input, kept next to the input file, so that
+  re-runs over an unchanged input can map the parsed columns straight
+  into memory instead of parsing the text again - or, for inputs which
+  only ever grow, parse just what was appended since.
+
+  A cache file holds a header and a sequence of blocks. Every block
+  holds the same number of columns of raw uint64_t values, each
+  preceded by its length. Solutions decide what a block means: one
+  block of whole columns, or one block per chunk of a streamed input.
+ */
+
+#ifndef INPUT_CACHE_H
+#define INPUT_CACHE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define INPUT_CACHE_MAGIC 0x454843414359434fUL
+#define INPUT_CACHE_VERSION 2
+#define INPUT_CACHE_MAX_COLUMNS 4
+#define INPUT_CACHE_KIND_LENGTH 16
+
+// Bytes at each end of the input which are hashed to recognize it, on
+// top of its size and modification time. An input which has changed
+// since - grown, say - is only recognized by a hash of all of it.
+#define INPUT_CACHE_SAMPLE_SIZE (64 * 1024)
+
+typedef struct {
+  uint64_t magic;
+  uint64_t version;
+  char kind[INPUT_CACHE_KIND_LENGTH]; // Which solution wrote the cache.
+  uint64_t num_columns;               // Columns per block.
+  uint64_t num_blocks;
+
+  // What the input looked like when it was parsed.
+  uint64_t input_size;
+  int64_t input_mtime_sec;
+  int64_t input_mtime_nsec;
+  uint64_t input_hash;  // Of its size and the samples at either end.
+  uint64_t prefix_hash; // Of its size and every byte.
+
+  uint64_t payload_checksum; // Over all of the blocks.
+  uint64_t header_checksum;  // Over all of the fields above.
+} input_cache_header;
+
+typedef struct {
+  const uint64_t* columns[INPUT_CACHE_MAX_COLUMNS];
+  size_t lengths[INPUT_CACHE_MAX_COLUMNS];
+} input_cache_block;
+
+typedef struct {
+  void* mapping;
+  size_t mapping_size;
+  input_cache_header* header;
+  input_cache_block* blocks; // Views into the mapping.
+  size_t num_blocks;
+} input_cache;
+
+typedef struct {
+  FILE* file;
+  char* temporary_path; // NULL when appending to a cache in place.
+  char* final_path;
+  input_cache_header header;
+} input_cache_writer;
+
+// Return the checksum of the fields of HEADER before header_checksum.
+uint64_t checksum_of_header(input_cache_header* header);
+
+// Return whether caching is switched on, by setting the environment
+// variable AOC_INPUT_CACHE to 1.
+bool input_cache_enabled();
+
+// Map the KIND cache of the input at INPUT_PATH, if caching is enabled
+// and there is one which matches the input as it is now with
+// NUM_COLUMNS columns per block. Return NULL otherwise.
+input_cache* load_input_cache(const char* input_path, const char* kind,
+                              size_t num_columns);
+
+// As load_input_cache, but also accepting a cache of the input as it
+// was before more was appended to it. The cache's header->input_size
+// is where the input not covered by the cache starts. Unless the input
+// is unchanged, all of that much of it is read to make sure.
+input_cache* load_input_cache_of_prefix(const char* input_path,
+                                        const char* kind,
+                                        size_t num_columns);
+
+// Unmap and free the given cache CACHE.
+void free_input_cache(input_cache* cache);
+
+// Return whether the blocks of CACHE match the checksum written with
+// them. This reads every value, which loading on its own never does.
+bool verify_input_cache(input_cache* cache);
+
+// Start writing the KIND cache of the input at INPUT_PATH, with
+// NUM_COLUMNS columns per block. Return NULL if caching is disabled or
+// the cache cannot be written.
+input_cache_writer* init_input_cache_writer(const char* input_path,
+                                            const char* kind,
+                                            size_t num_columns);
+
+// As init_input_cache_writer, for a cache of only the first SIZE bytes
+// of the input - which may have grown since they were parsed.
+input_cache_writer* init_input_cache_writer_of_prefix(const char* input_path,
+                                                      const char* kind,
+                                                      size_t num_columns,
+                                                      uint64_t size);
+
+// Start appending blocks to the loaded CACHE, of the KIND cache of the
+// input at INPUT_PATH, so that it covers the first SIZE bytes of the
+// input. The cache is extended in place rather than rewritten - and
+// until finished, it still loads as it was. Return NULL if caching is
+// disabled or the cache file has changed since CACHE was loaded.
+input_cache_writer* init_input_cache_appender(input_cache* cache,
+                                              const char* input_path,
+                                              const char* kind,
+                                              uint64_t size);
+
+// Append a block of the writer's number of COLUMNS, of the given
+// LENGTHS, to the cache being written by WRITER.
+void append_block_to_input_cache(input_cache_writer* writer,
+                                 const uint64_t** columns,
+                                 const size_t* lengths);
+
+// Complete the cache being written by WRITER and free it. Until then
+// the cache is not visible to load_input_cache.
+void finish_input_cache(input_cache_writer* writer);
+
+#endif
@@ -0,0 +1,173 @@
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "./alloc_accounting.h"
+#include "./dyn_array.h"
+#include "./join.h"
+
+// Return the length of the run of KEY starting at START in ARR.
+size_t run_length(const uint64_t* arr, size_t len, size_t start, uint64_t key) {
+  size_t end = start;
+  while (end < len && arr[end] == key) {
+    end += 1;
+  }
+  return end - start;
+}
+
+join_result merge_join_sorted_uint64(const uint64_t* lefts, size_t num_lefts,
+                                     const uint64_t* rights,
+                                     size_t num_rights) {
+  join_result result = {0, 0};
+
+  size_t i = 0;
+  size_t j = 0;
+  while (i < num_lefts && j < num_rights) {
+    uint64_t l = lefts[i];
+    uint64_t r = rights[j];
+    if (l < r) {
+      i += 1;
+    } else if (l > r) {
+      j += 1;
+    } else {
+      // Matching keys - consume the whole run on both sides at once.
+      size_t left_run  = run_length(lefts, num_lefts, i, l);
+      size_t right_run = run_length(rights, num_rights, j, r);
+
+      result.count += left_run * right_run;
+      result.weighted_sum += l * left_run * right_run;
+
+      i += left_run;
+      j += right_run;
+    }
+  }
+
+  return result;
+}
+
+// Return the first index at or after START in ARR whose element is
+// not less than KEY (or LEN if there is none). When UPPER is set,
+// return the first index whose element is greater than KEY instead.
+size_t gallop(const uint64_t* arr, size_t len, size_t start, uint64_t key,
+              bool upper) {
+  // Exponentially widen the step until overshooting KEY, which bounds
+  // the binary search to a range proportional to the distance moved.
+  size_t lo   = start;
+  size_t step = 1;
+  size_t hi   = start;
+  while (hi < len && (upper ? arr[hi] <= key : arr[hi] < key)) {
+    lo = hi + 1;
+    hi = start + step;
+    step *= 2;
+  }
+  if (hi > len) {
+    hi = len;
+  }
+
+  // Binary search in [lo, hi).
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (upper ? arr[mid] <= key : arr[mid] < key) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+
+  return lo;
+}
+
+join_result gallop_join_sorted_uint64(const uint64_t* lefts, size_t num_lefts,
+                                      const uint64_t* rights,
+                                      size_t num_rights) {
+  // Walk the shorter side run by run, galloping through the longer
+  // one. The join is symmetric so the sides can be swapped freely.
+  const uint64_t* small = lefts;
+  size_t num_small      = num_lefts;
+  const uint64_t* large = rights;
+  size_t num_large      = num_rights;
+  if (num_lefts > num_rights) {
+    small     = rights;
+    num_small = num_rights;
+    large     = lefts;
+    num_large = num_lefts;
+  }
+
+  join_result result = {0, 0};
+
+  size_t i = 0;
+  size_t j = 0;
+  while (i < num_small && j < num_large) {
+    uint64_t key     = small[i];
+    size_t small_run = run_length(small, num_small, i, key);
+
+    j = gallop(large, num_large, j, key, false);
+    if (j < num_large && large[j] == key) {
+      size_t large_end = gallop(large, num_large, j, key, true);
+      size_t large_run = large_end - j;
+
+      result.count += small_run * large_run;
+      result.weighted_sum += key * small_run * large_run;
+
+      j = large_end;
+    }
+
+    i += small_run;
+  }
+
+  return result;
+}
+
+join_result join_sorted_uint64(const uint64_t* lefts, size_t num_lefts,
+                               const uint64_t* rights, size_t num_rights) {
+  size_t shorter = num_lefts < num_rights ? num_lefts : num_rights;
+  size_t longer  = num_lefts < num_rights ? num_rights : num_lefts;
+
+  if (shorter * JOIN_GALLOP_RATIO <= longer) {
+    return gallop_join_sorted_uint64(lefts, num_lefts, rights, num_rights);
+  } else {
+    return merge_join_sorted_uint64(lefts, num_lefts, rights, num_rights);
+  }
+}
+
+// Move IDX forward to the start of the next run of equal keys in ARR,
+// unless it already starts one.
+size_t align_to_run(const uint64_t* arr, size_t len, size_t idx) {
+  while (idx > 0 && idx < len && arr[idx] == arr[idx - 1]) {
+    idx += 1;
+  }
+  return idx;
+}
+
+join_result join_sorted_uint64_runs(const uint64_t* lefts, size_t num_lefts,
+                                    const uint64_t* rights, size_t num_rights,
+                                    size_t begin, size_t end) {
+  begin = align_to_run(lefts, num_lefts, begin);
+  end   = align_to_run(lefts, num_lefts, end);
+  if (begin >= end) {
+    join_result nothing = {0, 0};
+    return nothing;
+  }
+
+  // The rights which can match are those from the first key of this
+  // range up to the first key of the next.
+  size_t rights_begin = gallop(rights, num_rights, 0, lefts[begin], false);
+  size_t rights_end   = num_rights;
+  if (end < num_lefts) {
+    rights_end = gallop(rights, num_rights, rights_begin, lefts[end], false);
+  }
+
+  return join_sorted_uint64(lefts + begin, end - begin, rights + rights_begin,
+                            rights_end - rights_begin);
+}
+
+join_result join_sorted_dyn_arrays(dyn_array* lefts, dyn_array* rights) {
+  assert(lefts->data_type == UINT64);
+  assert(rights->data_type == UINT64);
+
+  // UINT64 arrays store their elements inline, so the data buffer can
+  // be walked directly.
+  return join_sorted_uint64((uint64_t*)lefts->data, lefts->occupied,
+                            (uint64_t*)rights->data, rights->occupied);
+}
@@ -0,0 +1,51 @@
+/*
+  Multiplicity joins over sorted arrays of raw uint64_t keys - the
+  sort-based alternative to counting matches through a hash_table.
+ */
+
+#ifndef JOIN_H
+#define JOIN_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "./dyn_array.h"
+
+// When one side of a join is at least this many times longer than the
+// other, gallop through the longer side instead of merging linearly.
+#define JOIN_GALLOP_RATIO 32
+
+typedef struct {
+  uint64_t count;        // Number of matching (left, right) pairs.
+  uint64_t weighted_sum; // Sum over matching pairs of their shared key.
+} join_result;
+
+// Join the ascending LEFTS (NUM_LEFTS long) with the ascending RIGHTS
+// (NUM_RIGHTS long): every key present in both contributes the product
+// of its multiplicities to the result. Picks between a linear merge and
+// galloping based on the relative sizes.
+join_result join_sorted_uint64(const uint64_t* lefts, size_t num_lefts,
+                               const uint64_t* rights, size_t num_rights);
+
+// As join_sorted_uint64, always walking both sides in a single merge.
+join_result merge_join_sorted_uint64(const uint64_t* lefts, size_t num_lefts,
+                                     const uint64_t* rights,
+                                     size_t num_rights);
+
+// As join_sorted_uint64, always galloping through the longer side.
+join_result gallop_join_sorted_uint64(const uint64_t* lefts, size_t num_lefts,
+                                      const uint64_t* rights,
+                                      size_t num_rights);
+
+// As join_sorted_uint64, counting only the runs of equal LEFTS which
+// start at indices in [BEGIN, END). Joins over ranges which partition
+// the indices of LEFTS add up to the join over all of it, and can be
+// computed independently.
+join_result join_sorted_uint64_runs(const uint64_t* lefts, size_t num_lefts,
+                                    const uint64_t* rights, size_t num_rights,
+                                    size_t begin, size_t end);
+
+// Join the sorted UINT64 dynamic arrays LEFTS and RIGHTS.
+join_result join_sorted_dyn_arrays(dyn_array* lefts, dyn_array* rights);
+
+#endif
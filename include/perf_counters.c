@@ -0,0 +1,92 @@
+#include <linux/perf_event.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "./perf_counters.h"
+
+typedef struct {
+  uint32_t type;
+  uint64_t config;
+  const char* name;
+} perf_counter_spec;
+
+// L1 data cache reads which missed.
+#define L1D_READ_MISSES                                                        \
+  (PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |            \
+   (PERF_COUNT_HW_CACHE_RESULT_MISS << 16))
+
+static const perf_counter_spec specs[NUM_PERF_COUNTERS] = {
+    [PERF_INSTRUCTIONS] = {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS,
+                           "instructions"},
+    [PERF_CYCLES] = {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES,
+                     "cpu_cycles"},
+    [PERF_L1D_MISSES] = {PERF_TYPE_HW_CACHE, L1D_READ_MISSES, "l1d_misses"},
+    [PERF_LLC_MISSES] = {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES,
+                         "llc_misses"},
+    [PERF_BRANCH_MISSES] = {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES,
+                            "branch_misses"},
+    [PERF_PAGE_FAULTS] = {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS,
+                          "page_faults"},
+};
+
+// The calling thread's counter file descriptors, -1 where unavailable.
+static _Thread_local int fds[NUM_PERF_COUNTERS];
+static _Thread_local bool opened = false;
+
+const char* name_of_perf_counter(perf_counter_t counter) {
+  return specs[counter].name;
+}
+
+static void open_perf_counters() {
+  for (int c = 0; c < NUM_PERF_COUNTERS; c += 1) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size           = sizeof(attr);
+    attr.type           = specs[c].type;
+    attr.config         = specs[c].config;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv     = 1;
+    attr.read_format =
+        PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    // This thread, on any CPU, in no group.
+    fds[c] = syscall(SYS_perf_event_open, &attr, 0, -1, -1,
+                     PERF_FLAG_FD_CLOEXEC);
+  }
+  opened = true;
+}
+
+void read_perf_counters(perf_reading* reading) {
+  if (!opened) {
+    open_perf_counters();
+  }
+
+  reading->available = 0;
+  for (int c = 0; c < NUM_PERF_COUNTERS; c += 1) {
+    // The count, then the time enabled and the time running.
+    uint64_t values[3];
+    if (fds[c] < 0 || read(fds[c], values, sizeof(values)) != sizeof(values)) {
+      reading->values[c] = 0;
+      continue;
+    }
+
+    if (values[2] != 0 && values[2] < values[1]) {
+      values[0] = (uint64_t)((double)values[0] * values[1] / values[2]);
+    }
+    reading->values[c] = values[0];
+    reading->available |= 1u << c;
+  }
+}
+
+perf_reading perf_counters_between(perf_reading* before,
+                                   perf_reading* after) {
+  perf_reading between;
+  between.available = before->available & after->available;
+  for (int c = 0; c < NUM_PERF_COUNTERS; c += 1) {
+    between.values[c] = after->values[c] - before->values[c];
+  }
+  return between;
+}
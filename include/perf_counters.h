@@ -0,0 +1,47 @@
+/*
+  Hardware (and a software) performance counter readings of the
+  calling thread via perf_event_open, for telling whether code is
+  bound by cache or branch misses. Only user-space events are counted,
+  which most kernels permit without privileges. Counters the kernel or
+  hardware refuses - e.g. in most virtual machines - are left out, and
+  with none available readings are simply empty.
+
+  Work handed to other threads, like the thread pool's workers, is not
+  counted - run with AOC_THREADS=1 to count everything.
+ */
+
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef enum {
+  PERF_INSTRUCTIONS,
+  PERF_CYCLES,
+  PERF_L1D_MISSES, // L1 data cache read misses.
+  PERF_LLC_MISSES, // Last-level cache misses.
+  PERF_BRANCH_MISSES,
+  PERF_PAGE_FAULTS,
+  NUM_PERF_COUNTERS
+} perf_counter_t;
+
+typedef struct {
+  uint64_t values[NUM_PERF_COUNTERS];
+  uint32_t available; // Bit set of the counters which could be read.
+} perf_reading;
+
+// Return the name of the counter COUNTER, as reported.
+const char* name_of_perf_counter(perf_counter_t counter);
+
+// Read the calling thread's counters into READING, opening them on
+// first use. Counters which were multiplexed are scaled up to the
+// whole time they were enabled.
+void read_perf_counters(perf_reading* reading);
+
+// Return the counts from the reading BEFORE to the reading AFTER, which
+// are available in both.
+perf_reading perf_counters_between(perf_reading* before,
+                                   perf_reading* after);
+
+#endif
@@ -0,0 +1,109 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "./alloc_accounting.h"
+#include "./handler.h"
+#include "./runner.h"
+#include "./thread_pool.h"
+#include "./timing.h"
+
+// Registered by constructors before main, so never written concurrently.
+static registered_day days[MAX_DAYS];
+static size_t num_days = 0;
+
+void register_day(int day, int (*solve)(FILE* input_file)) {
+  if (day < 1 || day > MAX_DAYS) {
+    fprintf(stderr, "Cannot register day %d.\n", day);
+    exit(-1);
+  }
+  if (find_registered_day(day) != NULL) {
+    fprintf(stderr, "Day %d is registered twice.\n", day);
+    exit(-1);
+  }
+
+  // Keep the table in order of day.
+  size_t idx = num_days;
+  while (idx > 0 && days[idx - 1].day > day) {
+    days[idx] = days[idx - 1];
+    idx -= 1;
+  }
+  days[idx].day   = day;
+  days[idx].solve = solve;
+  snprintf(days[idx].input_path, MAX_DAY_INPUT_PATH, "day%02d/input.txt",
+           day);
+  num_days += 1;
+}
+
+const registered_day* find_registered_day(int day) {
+  for (size_t i = 0; i < num_days; i += 1) {
+    if (days[i].day == day) {
+      return &days[i];
+    }
+  }
+  return NULL;
+}
+
+const registered_day* registered_days(size_t* count) {
+  *count = num_days;
+  return days;
+}
+
+static uint64_t monotonic_ns() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+void run_day(void* v_runs, size_t begin, size_t end) {
+  day_run* runs = v_runs;
+  for (size_t i = begin; i < end; i += 1) {
+    day_run* run = &runs[i];
+    free(run->output);
+    run->output = NULL;
+    run->length = 0;
+
+    FILE* output = open_memstream(&run->output, &run->length);
+    char phase[16];
+    snprintf(phase, sizeof(phase), "day %02d", run->day->day);
+
+    begin_phase(phase);
+    uint64_t start = monotonic_ns();
+    run->status =
+        input_file_handler_with_output(run->input_path, output, run->day->solve);
+    run->wall_ns = monotonic_ns() - start;
+    end_phase();
+    fclose(output);
+  }
+}
+
+void run_days(day_run* runs, size_t num_runs) {
+  if (num_runs == 0) {
+    return;
+  }
+  // Days get a pool of their own, one thread per day. Were they run on
+  // the default pool, a day waiting on its own loops could pick up and
+  // run other days inline, nesting them and holding up its answers.
+  thread_pool* pool = init_thread_pool(num_runs - 1);
+  parallel_for(pool, 0, num_runs, 1, run_day, runs);
+  free_thread_pool(pool);
+}
+
+bool write_day_outputs(day_run* runs, size_t num_runs, FILE* output) {
+  bool succeeded = true;
+  for (size_t i = 0; i < num_runs; i += 1) {
+    fprintf(output, "Day %02d:\n", runs[i].day->day);
+    fwrite(runs[i].output, 1, runs[i].length, output);
+    succeeded = succeeded && runs[i].status == 0;
+  }
+  return succeeded;
+}
+
+void free_day_outputs(day_run* runs, size_t num_runs) {
+  for (size_t i = 0; i < num_runs; i += 1) {
+    free(runs[i].output);
+    runs[i].output = NULL;
+    runs[i].length = 0;
+  }
+}
@@ -0,0 +1,75 @@
+/*
+  A table of every day's solution, so that one binary can run any set
+  of days - concurrently, on the default thread pool, with each day's
+  answers buffered and written out in the order the days were given.
+
+  A solution ends with REGISTER_DAY(day, solve) instead of a main. On
+  its own that expands to the usual main; compiled with -DAOC_RUNNER it
+  instead adds the day to the table before the runner's main starts.
+ */
+
+#ifndef RUNNER_H
+#define RUNNER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "./handler.h"
+
+// Number of days in a calendar.
+#define MAX_DAYS 25
+
+// Longest default input path, e.g. "day01/input.txt".
+#define MAX_DAY_INPUT_PATH 32
+
+typedef struct {
+  int day;
+  int (*solve)(FILE* input_file);
+  char input_path[MAX_DAY_INPUT_PATH]; // Input used unless given another.
+} registered_day;
+
+typedef struct {
+  const registered_day* day;
+  char* input_path;
+  char* output;     // The day's answers, once it has run.
+  size_t length;    // Length of output.
+  int status;       // What solve returned.
+  uint64_t wall_ns; // Wall time of the day's last run.
+} day_run;
+
+#ifdef AOC_RUNNER
+#define REGISTER_DAY(day, solve)                                               \
+  __attribute__((constructor)) static void register_day_##day() {             \
+    register_day(day, solve);                                                  \
+  }
+#else
+#define REGISTER_DAY(day, solve)                                               \
+  int main(int argc, char** argv) {                                            \
+    return input_file_handler(argv[1], solve);                                 \
+  }
+#endif
+
+// Add DAY, solved by SOLVE, to the table. Registering a day twice is
+// an error.
+void register_day(int day, int (*solve)(FILE* input_file));
+
+// Return the registered day DAY, or NULL if there is none.
+const registered_day* find_registered_day(int day);
+
+// Return the registered days in ascending order, setting COUNT to how
+// many there are.
+const registered_day* registered_days(size_t* count);
+
+// Run each of the NUM_RUNS given days concurrently, filling in their
+// outputs, statuses and timings. Outputs of earlier runs are replaced.
+void run_days(day_run* runs, size_t num_runs);
+
+// Write the runs' outputs to OUTPUT in order, and return whether every
+// one of them succeeded.
+bool write_day_outputs(day_run* runs, size_t num_runs, FILE* output);
+
+// Free the outputs of the given runs.
+void free_day_outputs(day_run* runs, size_t num_runs);
+
+#endif
@@ -0,0 +1,179 @@
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "./alloc_accounting.h"
+#include "./dyn_array.h"
+#include "./search_index.h"
+
+// Keys per 64-byte cache line.
+#define KEYS_PER_LINE (64 / sizeof(uint64_t))
+
+// Fill the subtree rooted at layout index K with the in-order
+// traversal of SORTED, starting from sorted index I. Return the next
+// unconsumed sorted index.
+size_t fill_eytzinger(search_index* index, const uint64_t* sorted, size_t i,
+                      size_t k) {
+  if (k <= index->size) {
+    i                = fill_eytzinger(index, sorted, i, 2 * k);
+    index->layout[k] = sorted[i];
+    index->ranks[k]  = i;
+    i                = fill_eytzinger(index, sorted, i + 1, 2 * k + 1);
+  }
+  return i;
+}
+
+search_index* init_search_index_from_uint64(const uint64_t* sorted,
+                                            size_t size) {
+  // Every search relies on the order of the keys - an unsorted input
+  // gives silently wrong answers, not errors.
+  for (size_t i = 1; i < size; i += 1) {
+    assert(sorted[i - 1] <= sorted[i]);
+  }
+
+  search_index* index = malloc(sizeof(search_index));
+  index->size         = size;
+
+  // Align to a cache line so that each group of descendants the
+  // search prefetches shares as few lines as possible. aligned_alloc
+  // wants a multiple of the alignment.
+  size_t layout_bytes = (size + 1) * sizeof(uint64_t);
+  layout_bytes        = (layout_bytes + 63) / 64 * 64;
+  index->layout       = aligned_alloc(64, layout_bytes);
+  index->ranks        = malloc((size + 1) * sizeof(size_t));
+
+  index->layout[0] = 0;
+  index->ranks[0]  = size;
+  fill_eytzinger(index, sorted, 0, 1);
+
+  return index;
+}
+
+search_index* init_search_index(dyn_array* arr) {
+  assert(arr->data_type == UINT64);
+  return init_search_index_from_uint64((uint64_t*)arr->data, arr->occupied);
+}
+
+void free_search_index(search_index* index) {
+  free(index->layout);
+  free(index->ranks);
+  free(index);
+}
+
+// Descend from the root of INDEX and return the layout index of the
+// first key not less than KEY (or greater than KEY, if UPPER), which
+// is 0 if there is no such key.
+static inline size_t descend(search_index* index, uint64_t key, bool upper) {
+  const uint64_t* layout = index->layout;
+  size_t size            = index->size;
+
+  size_t k = 1;
+  while (k <= size) {
+    // The descendants four levels down occupy 16 consecutive slots -
+    // two cache lines of keys.
+    __builtin_prefetch(layout + 16 * k);
+    __builtin_prefetch(layout + 16 * k + KEYS_PER_LINE);
+
+    // Branchless: go right exactly when the key here is too small.
+    uint64_t here = layout[k];
+    k             = 2 * k + (upper ? here <= key : here < key);
+  }
+
+  // The path taken encodes every turn as a bit. The answer is the
+  // last node where the search turned left, so strip the trailing
+  // right turns and that final left turn.
+  return k >> __builtin_ffsll(~k);
+}
+
+size_t lower_bound_in_search_index(search_index* index, uint64_t key) {
+  return index->ranks[descend(index, key, false)];
+}
+
+size_t upper_bound_in_search_index(search_index* index, uint64_t key) {
+  return index->ranks[descend(index, key, true)];
+}
+
+size_t count_in_search_index(search_index* index, uint64_t key) {
+  return upper_bound_in_search_index(index, key) -
+         lower_bound_in_search_index(index, key);
+}
+
+bool contains_in_search_index(search_index* index, uint64_t key) {
+  size_t k = descend(index, key, false);
+  return k != 0 && index->layout[k] == key;
+}
+
+// Run up to SEARCH_INDEX_BATCH_WIDTH descents of KEYS in lockstep,
+// storing the resulting layout indices into NODES.
+static inline void descend_batch(search_index* index, const uint64_t* keys,
+                                 size_t num_keys, bool upper, size_t* nodes) {
+  const uint64_t* layout = index->layout;
+  size_t size            = index->size;
+
+  for (size_t q = 0; q < num_keys; q += 1) {
+    nodes[q] = 1;
+  }
+
+  // The top levels of the tree are complete, so every descent takes
+  // the same steps through them. Advance all of the queries one level
+  // at a time - their loads are independent and overlap in memory.
+  size_t full_levels = 63 - __builtin_clzll(size + 1);
+  for (size_t level = 0; level < full_levels; level += 1) {
+    for (size_t q = 0; q < num_keys; q += 1) {
+      size_t k = nodes[q];
+      __builtin_prefetch(layout + 16 * k);
+
+      uint64_t here = layout[k];
+      nodes[q]      = 2 * k + (upper ? here <= keys[q] : here < keys[q]);
+    }
+  }
+
+  // Some queries take one more step into the partial bottom level.
+  for (size_t q = 0; q < num_keys; q += 1) {
+    size_t k = nodes[q];
+    if (k <= size) {
+      k = 2 * k + (upper ? layout[k] <= keys[q] : layout[k] < keys[q]);
+    }
+    nodes[q] = k >> __builtin_ffsll(~k);
+  }
+}
+
+void lower_bound_batch_in_search_index(search_index* index,
+                                       const uint64_t* keys, size_t num_keys,
+                                       size_t* results) {
+  size_t nodes[SEARCH_INDEX_BATCH_WIDTH];
+  for (size_t start = 0; start < num_keys;
+       start += SEARCH_INDEX_BATCH_WIDTH) {
+    size_t width = num_keys - start;
+    if (width > SEARCH_INDEX_BATCH_WIDTH) {
+      width = SEARCH_INDEX_BATCH_WIDTH;
+    }
+
+    descend_batch(index, keys + start, width, false, nodes);
+    for (size_t q = 0; q < width; q += 1) {
+      results[start + q] = index->ranks[nodes[q]];
+    }
+  }
+}
+
+void count_batch_in_search_index(search_index* index, const uint64_t* keys,
+                                 size_t num_keys, size_t* results) {
+  size_t lower_nodes[SEARCH_INDEX_BATCH_WIDTH];
+  size_t upper_nodes[SEARCH_INDEX_BATCH_WIDTH];
+  for (size_t start = 0; start < num_keys;
+       start += SEARCH_INDEX_BATCH_WIDTH) {
+    size_t width = num_keys - start;
+    if (width > SEARCH_INDEX_BATCH_WIDTH) {
+      width = SEARCH_INDEX_BATCH_WIDTH;
+    }
+
+    descend_batch(index, keys + start, width, false, lower_nodes);
+    descend_batch(index, keys + start, width, true, upper_nodes);
+    for (size_t q = 0; q < width; q += 1) {
+      results[start + q] =
+          index->ranks[upper_nodes[q]] - index->ranks[lower_nodes[q]];
+    }
+  }
+}
@@ -0,0 +1,61 @@
+/*
+  A static search index over sorted raw uint64_t keys, stored in
+  Eytzinger (breadth-first) order so that every level of the implicit
+  binary search tree is contiguous and the next levels can be
+  prefetched while the current one is compared.
+ */
+
+#ifndef SEARCH_INDEX_H
+#define SEARCH_INDEX_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "./dyn_array.h"
+
+// Number of queries a batched search advances in lockstep.
+#define SEARCH_INDEX_BATCH_WIDTH 16
+
+typedef struct {
+  uint64_t* layout; // Keys in Eytzinger order, 1-indexed - layout[0] is unused.
+  size_t* ranks;    // Position in the sorted input of each layout entry.
+  size_t size;      // Number of keys in the index.
+} search_index;
+
+// Build a search index over the ascending keys SORTED (SIZE long).
+search_index* init_search_index_from_uint64(const uint64_t* sorted,
+                                            size_t size);
+
+// Build a search index over the sorted UINT64 dynamic array ARR.
+search_index* init_search_index(dyn_array* arr);
+
+// Free the given search index INDEX.
+void free_search_index(search_index* index);
+
+// Return the position in the sorted input of the first key not less
+// than KEY, or the number of keys if there is none.
+size_t lower_bound_in_search_index(search_index* index, uint64_t key);
+
+// Return the position in the sorted input of the first key greater
+// than KEY, or the number of keys if there is none.
+size_t upper_bound_in_search_index(search_index* index, uint64_t key);
+
+// Return how many times KEY occurs in INDEX.
+size_t count_in_search_index(search_index* index, uint64_t key);
+
+// Return whether KEY occurs in INDEX.
+bool contains_in_search_index(search_index* index, uint64_t key);
+
+// Store lower_bound_in_search_index of each of the NUM_KEYS KEYS into
+// RESULTS, interleaving the searches to overlap their memory accesses.
+void lower_bound_batch_in_search_index(search_index* index,
+                                       const uint64_t* keys, size_t num_keys,
+                                       size_t* results);
+
+// Store count_in_search_index of each of the NUM_KEYS KEYS into
+// RESULTS, interleaving the searches to overlap their memory accesses.
+void count_batch_in_search_index(search_index* index, const uint64_t* keys,
+                                 size_t num_keys, size_t* results);
+
+#endif
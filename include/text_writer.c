@@ -0,0 +1,160 @@
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "./alloc_accounting.h"
+#include "./text_writer.h"
+
+// "00" to "99", so that digits are produced two at a time.
+static const char digit_pairs[] = "00010203040506070809"
+                                  "10111213141516171819"
+                                  "20212223242526272829"
+                                  "30313233343536373839"
+                                  "40414243444546474849"
+                                  "50515253545556575859"
+                                  "60616263646566676869"
+                                  "70717273747576777879"
+                                  "80818283848586878889"
+                                  "90919293949596979899";
+
+static text_writer* init_writer(text_sink_t sink, size_t allocated) {
+  text_writer* writer = calloc(1, sizeof(text_writer));
+  writer->sink        = sink;
+  writer->buffer      = malloc(allocated * sizeof(char));
+  writer->allocated   = allocated;
+  writer->fd          = -1;
+  return writer;
+}
+
+text_writer* init_string_writer() {
+  return init_writer(TEXT_TO_STRING, TEXT_WRITER_INIT_SIZE);
+}
+
+text_writer* init_file_writer(FILE* file) {
+  text_writer* writer = init_writer(TEXT_TO_FILE, TEXT_WRITER_BUFFER_SIZE);
+  writer->file        = file;
+  return writer;
+}
+
+text_writer* init_fd_writer(int fd) {
+  text_writer* writer = init_writer(TEXT_TO_FD, TEXT_WRITER_BUFFER_SIZE);
+  writer->fd          = fd;
+  return writer;
+}
+
+// Write the LENGTH bytes at DATA straight out to WRITER's file.
+static void write_out(text_writer* writer, const char* data, size_t length) {
+  if (writer->sink == TEXT_TO_FILE) {
+    fwrite(data, sizeof(char), length, writer->file);
+    return;
+  }
+
+  size_t written = 0;
+  while (written < length) {
+    ssize_t got = write(writer->fd, data + written, length - written);
+    if (got < 0 && errno == EINTR) {
+      continue;
+    } else if (got < 0) {
+      perror("Error writing output");
+      exit(-1);
+    }
+    written += got;
+  }
+}
+
+void flush_text_writer(text_writer* writer) {
+  if (writer->sink != TEXT_TO_STRING) {
+    write_out(writer, writer->buffer, writer->length);
+    writer->length = 0;
+  }
+  if (writer->sink == TEXT_TO_FILE) {
+    fflush(writer->file);
+  }
+}
+
+void free_text_writer(text_writer* writer) {
+  flush_text_writer(writer);
+  free(writer->buffer);
+  free(writer);
+}
+
+char* finish_string_writer(text_writer* writer) {
+  write_char(writer, '\0');
+
+  // Shrink the string down to the required size.
+  char* string = realloc(writer->buffer, writer->length * sizeof(char));
+  free(writer);
+  return string;
+}
+
+// Make room for at least LENGTH more bytes in WRITER's buffer - unless
+// it streams and LENGTH is more than a whole buffer.
+static void make_room(text_writer* writer, size_t length) {
+  if (writer->length + length <= writer->allocated) {
+    return;
+  }
+  if (writer->sink != TEXT_TO_STRING) {
+    write_out(writer, writer->buffer, writer->length);
+    writer->length = 0;
+    return;
+  }
+
+  size_t allocated = writer->allocated;
+  while (writer->length + length > allocated) {
+    allocated *= 2;
+  }
+  writer->buffer    = realloc(writer->buffer, allocated * sizeof(char));
+  writer->allocated = allocated;
+}
+
+void write_text(text_writer* writer, const char* text, size_t length) {
+  make_room(writer, length);
+  if (length > writer->allocated) {
+    // Too long to buffer - straight out after what was buffered.
+    write_out(writer, text, length);
+    return;
+  }
+  memcpy(writer->buffer + writer->length, text, length);
+  writer->length += length;
+}
+
+void write_string(text_writer* writer, const char* string) {
+  write_text(writer, string, strlen(string));
+}
+
+void write_char(text_writer* writer, char c) {
+  make_room(writer, 1);
+  writer->buffer[writer->length++] = c;
+}
+
+void write_uint64(text_writer* writer, uint64_t value) {
+  // Digits are produced from the right, into the end of DIGITS.
+  char digits[TEXT_WRITER_MAX_DIGITS];
+  char* start = digits + TEXT_WRITER_MAX_DIGITS;
+  while (value >= 100) {
+    unsigned pair = value % 100;
+    value /= 100;
+    start -= 2;
+    memcpy(start, &digit_pairs[2 * pair], 2);
+  }
+  if (value >= 10) {
+    start -= 2;
+    memcpy(start, &digit_pairs[2 * value], 2);
+  } else {
+    *--start = '0' + value;
+  }
+  write_text(writer, start, digits + TEXT_WRITER_MAX_DIGITS - start);
+}
+
+void write_int64(text_writer* writer, int64_t value) {
+  if (value < 0) {
+    write_char(writer, '-');
+    // Negated as unsigned, which INT64_MIN survives.
+    write_uint64(writer, -(uint64_t)value);
+  } else {
+    write_uint64(writer, value);
+  }
+}
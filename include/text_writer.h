@@ -0,0 +1,75 @@
+/*
+  Text output built up in one buffer - either a string grown by
+  doubling, or a fixed buffer streamed out to a FILE* or a file
+  descriptor whenever it fills. Appending never rescans what has been
+  written, so building text is linear in its length.
+ */
+
+#ifndef TEXT_WRITER_H
+#define TEXT_WRITER_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// Starting size of a string's buffer.
+#define TEXT_WRITER_INIT_SIZE 64
+
+// Size of the buffer streamed out to a file.
+#define TEXT_WRITER_BUFFER_SIZE (64 * 1024)
+
+// Longest decimal representation of a 64-bit integer, sign included.
+#define TEXT_WRITER_MAX_DIGITS 20
+
+typedef enum {
+  TEXT_TO_STRING, // Grown to hold everything written.
+  TEXT_TO_FILE,   // Flushed to a FILE* when full.
+  TEXT_TO_FD      // Flushed to a file descriptor when full.
+} text_sink_t;
+
+typedef struct {
+  text_sink_t sink;
+  char* buffer;
+  size_t length;    // Bytes written to buffer and not yet flushed.
+  size_t allocated; // Size of buffer.
+  FILE* file;
+  int fd;
+} text_writer;
+
+// Initialize a writer building up a string.
+text_writer* init_string_writer();
+
+// Initialize a writer streaming to FILE, which stays owned by the
+// caller.
+text_writer* init_file_writer(FILE* file);
+
+// Initialize a writer streaming to the file descriptor FD, which stays
+// owned by the caller.
+text_writer* init_fd_writer(int fd);
+
+// Write out whatever WRITER is holding, unless it builds a string - on
+// through the FILE*'s own buffer too, if it has one.
+void flush_text_writer(text_writer* writer);
+
+// Flush and free the given writer WRITER.
+void free_text_writer(text_writer* writer);
+
+// Free the string writer WRITER, returning the string it built.
+char* finish_string_writer(text_writer* writer);
+
+// Write the LENGTH bytes at TEXT to WRITER.
+void write_text(text_writer* writer, const char* text, size_t length);
+
+// Write the null-terminated STRING to WRITER.
+void write_string(text_writer* writer, const char* string);
+
+// Write the character C to WRITER.
+void write_char(text_writer* writer, char c);
+
+// Write VALUE to WRITER in decimal.
+void write_uint64(text_writer* writer, uint64_t value);
+
+// Write VALUE to WRITER in decimal, with a '-' if it is negative.
+void write_int64(text_writer* writer, int64_t value);
+
+#endif
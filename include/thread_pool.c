@@ -0,0 +1,369 @@
+#include <assert.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "./alloc_accounting.h"
+#include "./dyn_array.h"
+#include "./thread_pool.h"
+
+struct parallel_job {
+  size_t begin; // Subranges are aligned to GRAIN from here.
+  size_t grain;
+  void (*body)(void* context, size_t begin, size_t end);
+  void* context;
+  atomic_size_t pending; // Indices not yet processed.
+};
+
+// The pool the current thread works for, if any, and its deque there.
+static _Thread_local thread_pool* current_pool = NULL;
+static _Thread_local size_t current_worker     = 0;
+
+// Return the index of the deque the current thread should use in POOL.
+size_t own_deque(thread_pool* pool) {
+  if (current_pool == pool) {
+    return current_worker;
+  } else {
+    // The shared deque for threads outside the pool.
+    return pool->num_workers;
+  }
+}
+
+void init_deque(thread_pool_deque* deque) {
+  pthread_mutex_init(&deque->lock, NULL);
+  deque->top       = 0;
+  deque->bottom    = 0;
+  deque->allocated = THREAD_POOL_DEQUE_INIT_SIZE;
+  deque->tasks     = malloc(deque->allocated * sizeof(thread_pool_task));
+}
+
+void free_deque(thread_pool_deque* deque) {
+  pthread_mutex_destroy(&deque->lock);
+  free(deque->tasks);
+}
+
+void push_task(thread_pool* pool, size_t deque_idx, thread_pool_task task) {
+  thread_pool_deque* deque = &pool->deques[deque_idx];
+
+  pthread_mutex_lock(&deque->lock);
+  if (deque->bottom - deque->top == deque->allocated) {
+    // Re-allocate a larger ring, unwrapping the contents in order.
+    size_t new_allocation_size = 2 * deque->allocated;
+    thread_pool_task* new_tasks =
+        malloc(new_allocation_size * sizeof(thread_pool_task));
+    for (size_t i = deque->top; i < deque->bottom; i += 1) {
+      new_tasks[i - deque->top] = deque->tasks[i % deque->allocated];
+    }
+    free(deque->tasks);
+
+    deque->bottom -= deque->top;
+    deque->top       = 0;
+    deque->tasks     = new_tasks;
+    deque->allocated = new_allocation_size;
+  }
+  deque->tasks[deque->bottom % deque->allocated] = task;
+  deque->bottom += 1;
+  pthread_mutex_unlock(&deque->lock);
+
+  // Wake a sleeping worker. Counting the task before taking the idle
+  // lock means a worker about to sleep either sees it or gets the
+  // signal.
+  atomic_fetch_add(&pool->queued, 1);
+  pthread_mutex_lock(&pool->idle_lock);
+  pthread_cond_signal(&pool->idle_cond);
+  pthread_mutex_unlock(&pool->idle_lock);
+}
+
+// Take a task from the deque at DEQUE_IDX, from the bottom if OWNER
+// and otherwise from the top. Return whether there was one.
+bool pop_task(thread_pool* pool, size_t deque_idx, bool owner,
+              thread_pool_task* task) {
+  thread_pool_deque* deque = &pool->deques[deque_idx];
+
+  bool found = false;
+  pthread_mutex_lock(&deque->lock);
+  if (deque->bottom > deque->top) {
+    if (owner) {
+      deque->bottom -= 1;
+      *task = deque->tasks[deque->bottom % deque->allocated];
+    } else {
+      *task = deque->tasks[deque->top % deque->allocated];
+      deque->top += 1;
+    }
+    found = true;
+  }
+  pthread_mutex_unlock(&deque->lock);
+
+  if (found) {
+    atomic_fetch_sub(&pool->queued, 1);
+  }
+  return found;
+}
+
+// Take a task for the owner of deque SELF - its own most recent one if
+// there is any, else the oldest one of another deque.
+bool take_task(thread_pool* pool, size_t self, thread_pool_task* task) {
+  if (pop_task(pool, self, true, task)) {
+    return true;
+  }
+
+  size_t num_deques = pool->num_workers + 1;
+  for (size_t i = 1; i < num_deques; i += 1) {
+    if (pop_task(pool, (self + i) % num_deques, false, task)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Process TASK on behalf of deque SELF: split off the upper halves of
+// its range for others to steal until one grain remains, then run it.
+void run_task(thread_pool* pool, size_t self, thread_pool_task task) {
+  struct parallel_job* job = task.job;
+
+  size_t begin = task.begin;
+  size_t end   = task.end;
+  while (end - begin > job->grain) {
+    // Split on a grain boundary, so that the final subranges are the
+    // same however the work happens to be divided up.
+    size_t grains = (end - begin + job->grain - 1) / job->grain;
+    size_t mid    = begin + (grains / 2) * job->grain;
+
+    thread_pool_task upper = {job, mid, end};
+    push_task(pool, self, upper);
+    end = mid;
+  }
+
+  job->body(job->context, begin, end);
+  atomic_fetch_sub(&job->pending, end - begin);
+}
+
+typedef struct {
+  thread_pool* pool;
+  size_t idx;
+} worker_arg;
+
+void* worker_main(void* v_arg) {
+  worker_arg* arg   = v_arg;
+  thread_pool* pool = arg->pool;
+  current_pool      = pool;
+  current_worker    = arg->idx;
+  free(arg);
+
+  while (true) {
+    thread_pool_task task;
+    if (take_task(pool, current_worker, &task)) {
+      run_task(pool, current_worker, task);
+      continue;
+    }
+
+    pthread_mutex_lock(&pool->idle_lock);
+    while (!pool->shutting_down && atomic_load(&pool->queued) == 0) {
+      pthread_cond_wait(&pool->idle_cond, &pool->idle_lock);
+    }
+    bool stop = pool->shutting_down;
+    pthread_mutex_unlock(&pool->idle_lock);
+
+    if (stop) {
+      break;
+    }
+  }
+
+  return NULL;
+}
+
+thread_pool* init_thread_pool(size_t num_workers) {
+  thread_pool* pool = malloc(sizeof(thread_pool));
+
+  pool->num_workers = num_workers;
+  pool->workers     = malloc(num_workers * sizeof(pthread_t));
+  pool->deques      = malloc((num_workers + 1) * sizeof(thread_pool_deque));
+  for (size_t i = 0; i < num_workers + 1; i += 1) {
+    init_deque(&pool->deques[i]);
+  }
+
+  pthread_mutex_init(&pool->idle_lock, NULL);
+  pthread_cond_init(&pool->idle_cond, NULL);
+  atomic_init(&pool->queued, 0);
+  pool->shutting_down = false;
+
+  for (size_t i = 0; i < num_workers; i += 1) {
+    worker_arg* arg = malloc(sizeof(worker_arg));
+    arg->pool       = pool;
+    arg->idx        = i;
+    pthread_create(&pool->workers[i], NULL, worker_main, arg);
+  }
+
+  return pool;
+}
+
+void free_thread_pool(thread_pool* pool) {
+  pthread_mutex_lock(&pool->idle_lock);
+  pool->shutting_down = true;
+  pthread_cond_broadcast(&pool->idle_cond);
+  pthread_mutex_unlock(&pool->idle_lock);
+
+  for (size_t i = 0; i < pool->num_workers; i += 1) {
+    pthread_join(pool->workers[i], NULL);
+  }
+
+  for (size_t i = 0; i < pool->num_workers + 1; i += 1) {
+    free_deque(&pool->deques[i]);
+  }
+  pthread_mutex_destroy(&pool->idle_lock);
+  pthread_cond_destroy(&pool->idle_cond);
+  free(pool->deques);
+  free(pool->workers);
+  free(pool);
+}
+
+static thread_pool* the_default_pool    = NULL;
+static pthread_once_t default_pool_once = PTHREAD_ONCE_INIT;
+
+void free_default_thread_pool() {
+  free_thread_pool(the_default_pool);
+}
+
+void init_default_thread_pool() {
+  long num_threads = THREAD_POOL_DEFAULT_THREADS;
+
+  char* env_threads = getenv("AOC_THREADS");
+  long online       = sysconf(_SC_NPROCESSORS_ONLN);
+  if (env_threads != NULL && atol(env_threads) > 0) {
+    num_threads = atol(env_threads);
+  } else if (online > 0) {
+    num_threads = online;
+  }
+
+  // The thread waiting on a loop is one of its threads.
+  the_default_pool = init_thread_pool(num_threads - 1);
+  atexit(free_default_thread_pool);
+}
+
+thread_pool* default_thread_pool() {
+  pthread_once(&default_pool_once, init_default_thread_pool);
+  return the_default_pool;
+}
+
+void parallel_for(thread_pool* pool, size_t begin, size_t end, size_t grain,
+                  void (*body)(void* context, size_t begin, size_t end),
+                  void* context) {
+  if (begin >= end) {
+    return;
+  }
+  if (grain == 0) {
+    grain = 1;
+  }
+
+  struct parallel_job job;
+  job.begin   = begin;
+  job.grain   = grain;
+  job.body    = body;
+  job.context = context;
+  atomic_init(&job.pending, end - begin);
+
+  // Start on the work directly, leaving the rest to be stolen.
+  size_t self           = own_deque(pool);
+  thread_pool_task task = {&job, begin, end};
+  run_task(pool, self, task);
+
+  // Help out until every subrange is done - possibly with tasks of
+  // other loops, which is what keeps nested loops from deadlocking.
+  while (atomic_load(&job.pending) > 0) {
+    if (take_task(pool, self, &task)) {
+      run_task(pool, self, task);
+    } else {
+      sched_yield();
+    }
+  }
+}
+
+typedef struct {
+  size_t begin;
+  size_t grain;
+  size_t result_size;
+  char* partials; // One partial result per grain-aligned subrange.
+  void (*map)(void* context, size_t begin, size_t end, void* partial);
+  void* context;
+} reduce_job;
+
+void reduce_body(void* v_job, size_t begin, size_t end) {
+  reduce_job* job = v_job;
+  size_t chunk    = (begin - job->begin) / job->grain;
+  job->map(job->context, begin, end, job->partials + chunk * job->result_size);
+}
+
+void parallel_reduce(thread_pool* pool, size_t begin, size_t end, size_t grain,
+                     void* result, size_t result_size,
+                     void (*map)(void* context, size_t begin, size_t end,
+                                 void* partial),
+                     void (*combine)(void* result, const void* partial),
+                     void* context) {
+  if (begin >= end) {
+    return;
+  }
+  if (grain == 0) {
+    grain = 1;
+  }
+
+  size_t num_chunks = (end - begin + grain - 1) / grain;
+
+  reduce_job job;
+  job.begin       = begin;
+  job.grain       = grain;
+  job.result_size = result_size;
+  job.partials    = malloc(num_chunks * result_size);
+  job.map         = map;
+  job.context     = context;
+
+  parallel_for(pool, begin, end, grain, reduce_body, &job);
+
+  // Fold in a fixed order, so that even a non-commutative COMBINE
+  // gives the same answer for any number of workers.
+  for (size_t i = 0; i < num_chunks; i += 1) {
+    combine(result, job.partials + i * result_size);
+  }
+
+  free(job.partials);
+}
+
+typedef struct {
+  dyn_array* arr;
+  void (*body)(void* context, dyn_array* arr, size_t begin, size_t end);
+  void (*map)(void* context, dyn_array* arr, size_t begin, size_t end,
+              void* partial);
+  void* context;
+} dyn_array_job;
+
+void dyn_array_body(void* v_job, size_t begin, size_t end) {
+  dyn_array_job* job = v_job;
+  job->body(job->context, job->arr, begin, end);
+}
+
+void dyn_array_map(void* v_job, size_t begin, size_t end, void* partial) {
+  dyn_array_job* job = v_job;
+  job->map(job->context, job->arr, begin, end, partial);
+}
+
+void parallel_for_dyn_array(thread_pool* pool, dyn_array* arr, size_t grain,
+                            void (*body)(void* context, dyn_array* arr,
+                                         size_t begin, size_t end),
+                            void* context) {
+  dyn_array_job job = {arr, body, NULL, context};
+  parallel_for(pool, 0, arr->occupied, grain, dyn_array_body, &job);
+}
+
+void parallel_reduce_dyn_array(
+    thread_pool* pool, dyn_array* arr, size_t grain, void* result,
+    size_t result_size,
+    void (*map)(void* context, dyn_array* arr, size_t begin, size_t end,
+                void* partial),
+    void (*combine)(void* result, const void* partial), void* context) {
+  dyn_array_job job = {arr, NULL, map, context};
+  parallel_reduce(pool, 0, arr->occupied, grain, result, result_size,
+                  dyn_array_map, combine, &job);
+}
@@ -0,0 +1,100 @@
+/*
+  A fixed-size work-stealing thread pool, with parallel loops and
+  reductions over index ranges and dynamic arrays.
+ */
+
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "./dyn_array.h"
+
+#define THREAD_POOL_DEQUE_INIT_SIZE 64
+
+// Number of threads working on the default pool's loops when neither
+// the environment variable AOC_THREADS nor the system's processor
+// count say otherwise.
+#define THREAD_POOL_DEFAULT_THREADS 4
+
+struct parallel_job;
+
+typedef struct {
+  struct parallel_job* job; // The loop this piece of work belongs to.
+  size_t begin;             // First index of the range to process.
+  size_t end;               // One past the last index of the range.
+} thread_pool_task;
+
+typedef struct {
+  pthread_mutex_t lock;
+  thread_pool_task* tasks; // Ring buffer - the owner works at the bottom,
+  size_t top;              // thieves take from the top.
+  size_t bottom;
+  size_t allocated;
+} thread_pool_deque;
+
+typedef struct {
+  size_t num_workers;
+  pthread_t* workers;
+
+  // One deque per worker, plus a final shared one for threads outside
+  // the pool.
+  thread_pool_deque* deques;
+
+  // Idle workers sleep on this until there are tasks to take.
+  pthread_mutex_t idle_lock;
+  pthread_cond_t idle_cond;
+  atomic_size_t queued; // Tasks sitting in any deque.
+  bool shutting_down;
+} thread_pool;
+
+// Initialize a thread pool of NUM_WORKERS threads. The thread waiting
+// on a loop works on it too, so a pool of no workers runs everything
+// on the calling thread.
+thread_pool* init_thread_pool(size_t num_workers);
+
+// Stop and free the given thread pool POOL.
+void free_thread_pool(thread_pool* pool);
+
+// Return a process-wide pool, started on first use and stopped at
+// exit. Loops on it use AOC_THREADS threads in total if that is set,
+// else one per processor.
+thread_pool* default_thread_pool();
+
+// Call BODY(CONTEXT, b, e) on consecutive subranges of [BEGIN, END),
+// each at most GRAIN long, spread across POOL. Returns once every
+// subrange has been processed; the calling thread helps meanwhile.
+void parallel_for(thread_pool* pool, size_t begin, size_t end, size_t grain,
+                  void (*body)(void* context, size_t begin, size_t end),
+                  void* context);
+
+// Reduce [BEGIN, END) into RESULT (RESULT_SIZE bytes, holding the
+// identity on entry). MAP(CONTEXT, b, e, partial) fills in a partial
+// result for each subrange of at most GRAIN elements, and the partials
+// are folded with COMBINE(RESULT, partial) in subrange order - so the
+// result does not depend on the number of workers.
+void parallel_reduce(thread_pool* pool, size_t begin, size_t end, size_t grain,
+                     void* result, size_t result_size,
+                     void (*map)(void* context, size_t begin, size_t end,
+                                 void* partial),
+                     void (*combine)(void* result, const void* partial),
+                     void* context);
+
+// As parallel_for, over the indices of the dynamic array ARR.
+void parallel_for_dyn_array(thread_pool* pool, dyn_array* arr, size_t grain,
+                            void (*body)(void* context, dyn_array* arr,
+                                         size_t begin, size_t end),
+                            void* context);
+
+// As parallel_reduce, over the indices of the dynamic array ARR.
+void parallel_reduce_dyn_array(
+    thread_pool* pool, dyn_array* arr, size_t grain, void* result,
+    size_t result_size,
+    void (*map)(void* context, dyn_array* arr, size_t begin, size_t end,
+                void* partial),
+    void (*combine)(void* result, const void* partial), void* context);
+
+#endif
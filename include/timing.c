@@ -0,0 +1,219 @@
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "./alloc_accounting.h"
+#include "./perf_counters.h"
+#include "./timing.h"
+
+typedef enum { TIMING_OFF, TIMING_STDERR, TIMING_JSON } timing_output;
+
+typedef struct {
+  const char* name;
+  uint64_t wall_ns;
+  uint64_t cpu_ns;
+  uint64_t cycles;
+  alloc_counters allocs;
+  perf_reading counters;
+} open_phase;
+
+static pthread_once_t timing_once = PTHREAD_ONCE_INIT;
+static timing_output output       = TIMING_OFF;
+static const char* json_path      = NULL;
+static bool count_perf_events     = false;
+
+// Ended phases to be written as JSON. Kept off the heap, so timing
+// does not show up in the allocations it reports.
+static pthread_mutex_t finished_lock = PTHREAD_MUTEX_INITIALIZER;
+static phase_timing finished[MAX_REPORTED_PHASES];
+static size_t num_finished = 0;
+static size_t num_flushed  = 0;
+static size_t num_dropped  = 0;
+
+static _Thread_local open_phase open_phases[MAX_PHASE_DEPTH];
+static _Thread_local unsigned depth = 0;
+
+static void init_timing() {
+  const char* setting = getenv("AOC_TIMING");
+  if (setting == NULL || setting[0] == '\0') {
+    output = TIMING_OFF;
+  } else if (strcmp(setting, "stderr") == 0) {
+    output = TIMING_STDERR;
+  } else {
+    output    = TIMING_JSON;
+    json_path = setting;
+    atexit(flush_phase_timings);
+  }
+
+  const char* perf = getenv("AOC_PERF");
+  count_perf_events =
+      output != TIMING_OFF && (perf == NULL || strcmp(perf, "0") != 0);
+}
+
+bool timing_enabled() {
+  pthread_once(&timing_once, init_timing);
+  return output != TIMING_OFF;
+}
+
+static uint64_t ns_of_clock(clockid_t clock) {
+  struct timespec now;
+  clock_gettime(clock, &now);
+  return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+static uint64_t read_cycles() {
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return 0;
+#endif
+}
+
+void begin_phase(const char* name) {
+  if (!timing_enabled()) {
+    return;
+  }
+  if (depth == MAX_PHASE_DEPTH) {
+    fprintf(stderr, "Phases nested too deep at '%s'.\n", name);
+    exit(-1);
+  }
+
+  open_phase* phase = &open_phases[depth++];
+  phase->name       = name;
+  phase->allocs     = alloc_totals();
+  if (count_perf_events) {
+    read_perf_counters(&phase->counters);
+  }
+  phase->cycles  = read_cycles();
+  phase->cpu_ns  = ns_of_clock(CLOCK_PROCESS_CPUTIME_ID);
+  phase->wall_ns = ns_of_clock(CLOCK_MONOTONIC);
+}
+
+void end_phase() {
+  if (!timing_enabled()) {
+    return;
+  }
+  if (depth == 0) {
+    fprintf(stderr, "Ending a phase when none is open.\n");
+    exit(-1);
+  }
+
+  uint64_t wall_ns      = ns_of_clock(CLOCK_MONOTONIC);
+  uint64_t cpu_ns       = ns_of_clock(CLOCK_PROCESS_CPUTIME_ID);
+  uint64_t cycles       = read_cycles();
+  alloc_counters allocs = alloc_totals();
+  perf_reading counters = {{0}, 0};
+  if (count_perf_events) {
+    read_perf_counters(&counters);
+  }
+
+  depth -= 1;
+  open_phase* phase = &open_phases[depth];
+
+  phase_timing timing;
+  timing.depth       = depth;
+  timing.wall_ns     = wall_ns - phase->wall_ns;
+  timing.cpu_ns      = cpu_ns - phase->cpu_ns;
+  timing.cycles      = cycles - phase->cycles;
+  timing.alloc_calls = allocs.calls - phase->allocs.calls;
+  timing.alloc_bytes =
+      (int64_t)allocs.live_bytes - (int64_t)phase->allocs.live_bytes;
+  if (count_perf_events) {
+    timing.counters = perf_counters_between(&phase->counters, &counters);
+  } else {
+    timing.counters.available = 0;
+  }
+
+  size_t length = 0;
+  for (unsigned i = 0; i <= depth && length < MAX_PHASE_PATH; i += 1) {
+    length += snprintf(timing.path + length, MAX_PHASE_PATH - length,
+                       i == 0 ? "%s" : "/%s", open_phases[i].name);
+  }
+
+  if (output == TIMING_STDERR) {
+    fprintf(stderr, "timing: %*s%-*s wall %10.3f ms  cpu %10.3f ms",
+            2 * (int)depth, "", 32 - 2 * (int)depth, timing.path,
+            timing.wall_ns / 1e6, timing.cpu_ns / 1e6);
+    if (timing.cycles != 0) {
+      fprintf(stderr, "  %12lu cycles", timing.cycles);
+    }
+    if (alloc_accounting_enabled()) {
+      fprintf(stderr, "  %8lu allocs %+12ld B", timing.alloc_calls,
+              timing.alloc_bytes);
+    }
+    for (int c = 0; c < NUM_PERF_COUNTERS; c += 1) {
+      if (timing.counters.available & (1u << c)) {
+        fprintf(stderr, "  %s %lu", name_of_perf_counter(c),
+                timing.counters.values[c]);
+      }
+    }
+    fprintf(stderr, "\n");
+  } else {
+    pthread_mutex_lock(&finished_lock);
+    if (num_finished < MAX_REPORTED_PHASES) {
+      finished[num_finished++] = timing;
+    } else {
+      num_dropped += 1;
+    }
+    pthread_mutex_unlock(&finished_lock);
+  }
+}
+
+void flush_phase_timings() {
+  if (!timing_enabled() || output != TIMING_JSON) {
+    return;
+  }
+
+  pthread_mutex_lock(&finished_lock);
+  if (num_finished == num_flushed) {
+    pthread_mutex_unlock(&finished_lock);
+    return;
+  }
+
+  // Every phase so far is rewritten, so the file is always whole.
+  num_flushed = num_finished;
+  FILE* out   = fopen(json_path, "w");
+  if (out == NULL) {
+    perror(json_path);
+  } else {
+    fprintf(out, "[");
+    for (size_t i = 0; i < num_finished; i += 1) {
+      phase_timing* timing = &finished[i];
+      fprintf(out,
+              "%s\n  {\"phase\": \"%s\", \"depth\": %u, \"wall_ns\": %lu, "
+              "\"cpu_ns\": %lu",
+              i == 0 ? "" : ",", timing->path, timing->depth, timing->wall_ns,
+              timing->cpu_ns);
+      if (timing->cycles != 0) {
+        fprintf(out, ", \"cycles\": %lu", timing->cycles);
+      }
+      if (alloc_accounting_enabled()) {
+        fprintf(out, ", \"alloc_calls\": %lu, \"alloc_bytes\": %ld",
+                timing->alloc_calls, timing->alloc_bytes);
+      }
+      for (int c = 0; c < NUM_PERF_COUNTERS; c += 1) {
+        if (timing->counters.available & (1u << c)) {
+          fprintf(out, ", \"%s\": %lu", name_of_perf_counter(c),
+                  timing->counters.values[c]);
+        }
+      }
+      fprintf(out, "}");
+    }
+    fprintf(out, "\n]\n");
+    fclose(out);
+
+    if (num_dropped > 0) {
+      fprintf(stderr, "timing: %lu phases past the first %d not written\n",
+              num_dropped, MAX_REPORTED_PHASES);
+    }
+  }
+  pthread_mutex_unlock(&finished_lock);
+}
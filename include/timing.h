@@ -0,0 +1,56 @@
+/*
+  Timing of nested phases of a solution. Each thread keeps its own
+  stack of open phases. When a phase ends, its wall time, the CPU time
+  of the whole process (so work done by the thread pool counts), the
+  timestamp counter cycles where there is one, the allocations if
+  they are accounted, and the performance counters the system permits
+  (unless AOC_PERF=0) are reported.
+
+  Reporting is picked by the environment variable AOC_TIMING: unset
+  for none, "stderr" for a line per phase on stderr, or otherwise a
+  path to write every phase to as JSON at exit. stdout is never
+  written to.
+ */
+
+#ifndef TIMING_H
+#define TIMING_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "./perf_counters.h"
+
+// Deepest nesting of phases on one thread.
+#define MAX_PHASE_DEPTH 16
+
+// Most phases written as JSON in one run.
+#define MAX_REPORTED_PHASES 4096
+
+// Longest phase path reported, e.g. "solve/parse/sort".
+#define MAX_PHASE_PATH 128
+
+typedef struct {
+  char path[MAX_PHASE_PATH]; // Names of the enclosing phases and this
+                             // one, separated by '/'.
+  unsigned depth;            // Number of enclosing phases.
+  uint64_t wall_ns;
+  uint64_t cpu_ns;
+  uint64_t cycles;       // Timestamp counter cycles, or 0 if there is none.
+  uint64_t alloc_calls;  // Allocating calls, if accounted.
+  int64_t alloc_bytes;   // Change in live bytes, if accounted.
+  perf_reading counters; // Performance counters of the phase's thread.
+} phase_timing;
+
+// Return whether phases are being reported.
+bool timing_enabled();
+
+// Start a phase called NAME, nested in the current thread's open phase.
+void begin_phase(const char* name);
+
+// End the current thread's innermost open phase, and report it.
+void end_phase();
+
+// Write out any phases not yet written.
+void flush_phase_timings();
+
+#endif
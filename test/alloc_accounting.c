@@ -0,0 +1,52 @@
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "../include/alloc_accounting.h"
+#include "../include/dyn_array.h"
+#include "../include/hash_table.h"
+
+void run_test(char* name, int (*test)()) {
+  printf("- %s\n", name);
+  int res = test();
+  printf(" - result: %d\n", res);
+}
+
+int live_bytes_follow_structures() {
+  alloc_counters before = alloc_totals();
+
+  dyn_array* arr    = init_dyn_array(UINT64);
+  hash_table* table = init_hash_table(UINT64, UINT64);
+  for (uint64_t i = 1; i <= 1000; i += 1) {
+    push_onto_dyn_array(arr, (void*)i);
+    set_entry_in_hash_table(table, (void*)i, (void*)i);
+  }
+  char* pp = pp_dyn_array(arr);
+
+  alloc_counters during = alloc_totals();
+  free(pp);
+  free_hash_table(table);
+  free_dyn_array(arr);
+  alloc_counters after = alloc_totals();
+
+  if (!alloc_accounting_enabled()) {
+    // Nothing is counted at all.
+    return during.calls == 0 ? 0 : -1;
+  }
+
+  if (during.live_bytes < before.live_bytes + 1000 * sizeof(uint64_t) ||
+      during.peak_bytes < during.live_bytes ||
+      after.live_bytes != before.live_bytes ||
+      after.frees - before.frees != after.calls - before.calls) {
+    return -1;
+  }
+  return report_alloc_leaks(stderr) == 0 ? 0 : -1;
+}
+
+int main(int argc, char** argv) {
+  printf("Running Tests\n");
+  printf("-------------\n");
+  run_test("live_bytes_follow_structures", live_bytes_follow_structures);
+
+  return 0;
+}
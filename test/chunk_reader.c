@@ -0,0 +1,189 @@
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../include/chunk_reader.h"
+
+void run_test(char* name, int (*test)()) {
+  printf("- %s\n", name);
+  int res = test();
+  printf(" - result: %d\n", res);
+}
+
+// Write LENGTH bytes of CONTENT to a fresh temporary file and return
+// an open descriptor onto it.
+int temporary_file(const char* content, size_t length) {
+  char path[] = "/tmp/chunk_reader_test_XXXXXX";
+  int fd      = mkstemp(path);
+  unlink(path);
+  assert(write(fd, content, length) == (ssize_t)length);
+  lseek(fd, 0, SEEK_SET);
+  return fd;
+}
+
+// Read all of READER, which is then freed, checking that the chunks
+// are made of whole lines and put back together into the LENGTH bytes
+// of EXPECTED.
+int check_chunks(chunk_reader* reader, const char* expected, size_t length) {
+  int res         = 0;
+  size_t position = 0;
+  size_t chunk_length;
+  const char* chunk;
+  while ((chunk = next_chunk(reader, &chunk_length)) != NULL) {
+    if (chunk_length == 0 || position + chunk_length > length ||
+        memcmp(chunk, expected + position, chunk_length) != 0) {
+      res = -1;
+      break;
+    }
+    position += chunk_length;
+
+    // Only the very end of the input may be a partial line.
+    if (chunk[chunk_length - 1] != '\n' && position != length) {
+      res = -2;
+      break;
+    }
+  }
+  if (res == 0 && position != length) {
+    res = -3;
+  }
+
+  free_chunk_reader(reader);
+  return res;
+}
+
+// As check_chunks, reading FD through BACKEND.
+int check_reassembly(int fd, chunk_reader_backend backend,
+                     const char* expected, size_t length) {
+  return check_chunks(init_chunk_reader_with_backend(fd, backend), expected,
+                      length);
+}
+
+// Check reassembly of LENGTH bytes of CONTENT through both backends and
+// through a pipe.
+int check_all_sources(const char* content, size_t length) {
+  chunk_reader_backend backends[] = {IO_URING, READER_THREAD};
+  for (size_t i = 0; i < 2; i += 1) {
+    int fd  = temporary_file(content, length);
+    int res = check_reassembly(fd, backends[i], content, length);
+    close(fd);
+    if (res != 0) {
+      return res;
+    }
+  }
+
+  int pipe_fds[2];
+  assert(pipe(pipe_fds) == 0);
+  if (fork() == 0) {
+    close(pipe_fds[0]);
+    assert(write(pipe_fds[1], content, length) == (ssize_t)length);
+    _exit(0);
+  }
+  close(pipe_fds[1]);
+  int res = check_reassembly(pipe_fds[0], IO_URING, content, length);
+  close(pipe_fds[0]);
+  return res;
+}
+
+// Lines of varying length, exactly LENGTH bytes in all, ending in a
+// newline if TRAILING_NEWLINE.
+char* make_lines(size_t length, bool trailing_newline) {
+  char* content = malloc(length + 1);
+  for (size_t i = 0; i < length; i += 1) {
+    content[i] = (i * 7919) % 61 == 0 ? '\n' : '0' + i % 10;
+  }
+  if (length > 0) {
+    content[length - 1] = trailing_newline ? '\n' : '7';
+  }
+  return content;
+}
+
+int empty_input() {
+  return check_all_sources("", 0);
+}
+
+int sizes_around_buffer_boundaries() {
+  size_t sizes[] = {1,
+                    100,
+                    CHUNK_READER_BUFFER_SIZE - 1,
+                    CHUNK_READER_BUFFER_SIZE,
+                    CHUNK_READER_BUFFER_SIZE + 1,
+                    3 * CHUNK_READER_BUFFER_SIZE,
+                    CHUNK_READER_DEPTH * CHUNK_READER_BUFFER_SIZE + 12345};
+  for (size_t i = 0; i < sizeof(sizes) / sizeof(size_t); i += 1) {
+    for (int trailing = 0; trailing <= 1; trailing += 1) {
+      char* content = make_lines(sizes[i], trailing);
+      int res       = check_all_sources(content, sizes[i]);
+      free(content);
+      if (res != 0) {
+        return res;
+      }
+    }
+  }
+  return 0;
+}
+
+int line_longer_than_buffers() {
+  size_t length = 3 * CHUNK_READER_BUFFER_SIZE + 10;
+  char* content = make_lines(length, true);
+
+  // One line spanning more than two whole buffers.
+  memset(content + 5, 'x', 2 * CHUNK_READER_BUFFER_SIZE + 100);
+
+  int res = check_all_sources(content, length);
+  free(content);
+  return res;
+}
+
+int reads_from_offset() {
+  size_t length    = 2 * CHUNK_READER_BUFFER_SIZE + 100;
+  char* content    = make_lines(length, true);
+  size_t offsets[] = {0, 1, CHUNK_READER_BUFFER_SIZE + 3, length - 1, length};
+
+  int res                = 0;
+  const char* backends[] = {"io_uring", "thread"};
+  for (size_t b = 0; b < 2 && res == 0; b += 1) {
+    setenv("AOC_READER", backends[b], 1);
+    for (size_t i = 0; i < sizeof(offsets) / sizeof(size_t) && res == 0;
+         i += 1) {
+      int fd = temporary_file(content, length);
+      res    = check_chunks(init_chunk_reader_at(fd, offsets[i]),
+                            content + offsets[i], length - offsets[i]);
+      close(fd);
+    }
+  }
+  unsetenv("AOC_READER");
+
+  free(content);
+  return res;
+}
+
+int parses_numbers() {
+  const char* text = "12 0 18446744073709551615x";
+  const char* end  = text + strlen(text);
+  uint64_t value;
+
+  const char* cursor = parse_uint64(text, end, &value);
+  assert(value == 12 && *cursor == ' ');
+  cursor = parse_uint64(cursor + 1, end, &value);
+  assert(value == 0 && *cursor == ' ');
+  cursor = parse_uint64(cursor + 1, end, &value);
+  assert(value == UINT64_MAX && *cursor == 'x');
+  assert(parse_uint64(cursor, end, &value) == cursor);
+
+  return 0;
+}
+
+int main(int argc, char** argv) {
+  printf("Running Tests\n");
+  printf("-------------\n");
+  run_test("empty_input", empty_input);
+  run_test("sizes_around_buffer_boundaries", sizes_around_buffer_boundaries);
+  run_test("line_longer_than_buffers", line_longer_than_buffers);
+  run_test("reads_from_offset", reads_from_offset);
+  run_test("parses_numbers", parses_numbers);
+
+  return 0;
+}
@@ -0,0 +1,187 @@
+// Day 01 keeps state between runs over an input which grows. Whatever
+// has happened to the input or the state, its answers have to be those
+// of a fresh parse.
+#define AOC_RUNNER
+#include "../day01/solution.c"
+
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+// Lines of the generated input - enough that its middle is far from
+// the ends input caches sample.
+#define NUM_LINES 100000
+
+void run_test(char* name, int (*test)()) {
+  printf("- %s\n", name);
+  int res = test();
+  printf(" - result: %d\n", res);
+}
+
+// Return a newly-alloced input of NUM_LINES lines of pairs, drawn from
+// few enough values that many of them match up.
+char* generate_input() {
+  char* input   = malloc(NUM_LINES * 16);
+  size_t length = 0;
+  uint64_t seed = 1;
+  for (size_t i = 0; i < NUM_LINES; i += 1) {
+    seed = seed * 6364136223846793005UL + 1442695040888963407UL;
+    length += sprintf(input + length, "%lu   %lu\n", (seed >> 33) % 1000,
+                      (seed >> 45) % 1000);
+  }
+  return input;
+}
+
+// Return the offset just past the end of the line of INPUT, of LENGTH
+// bytes, which OFFSET is in.
+size_t end_of_line(const char* input, size_t length, size_t offset) {
+  const char* newline = memchr(input + offset, '\n', length - offset);
+  return newline + 1 - input;
+}
+
+// Append the LENGTH bytes at CONTENT to the file at PATH.
+void append_to_file(const char* path, const char* content, size_t length) {
+  int fd = open(path, O_WRONLY | O_CREAT | O_APPEND, 0600);
+  assert(write(fd, content, length) == (ssize_t)length);
+  close(fd);
+}
+
+// Return the newly-alloced answers of day 01 for the input at PATH,
+// keeping state between runs if CACHED.
+char* answers(char* path, bool cached) {
+  if (cached) {
+    setenv("AOC_INPUT_CACHE", "1", 1);
+  } else {
+    unsetenv("AOC_INPUT_CACHE");
+  }
+  char* output;
+  size_t length;
+  FILE* output_file = open_memstream(&output, &length);
+  assert(input_file_handler_with_output(path, output_file, solve) == 0);
+  fclose(output_file);
+  return output;
+}
+
+// Return whether the answers for the input at PATH from the state kept
+// for it match those of a fresh parse.
+bool matches_fresh_parse(char* path) {
+  char* kept    = answers(path, true);
+  char* fresh   = answers(path, false);
+  bool matching = strcmp(kept, fresh) == 0;
+  free(kept);
+  free(fresh);
+  return matching;
+}
+
+// Remove the input at PATH and the state kept for it.
+void remove_input(const char* path) {
+  char state[256];
+  snprintf(state, sizeof(state), "%s.day01.cache", path);
+  unlink(state);
+  unlink(path);
+}
+
+int appends() {
+  char* input   = generate_input();
+  size_t length = strlen(input);
+  char path[]   = "/tmp/day01_state_test_XXXXXX";
+  close(mkstemp(path));
+
+  // More appends than there are kept runs, so that they are compacted -
+  // every third one cut partway through a line.
+  int res       = 0;
+  size_t cut    = 0;
+  size_t pieces = 3 * MAX_KEPT_RUNS;
+  for (size_t i = 1; i <= pieces && res == 0; i += 1) {
+    size_t next = end_of_line(input, length, length * i / pieces - 1);
+    if (i % 3 == 0 && i < pieces) {
+      next -= 5;
+    }
+    append_to_file(path, input + cut, next - cut);
+    cut = next;
+    if (!matches_fresh_parse(path)) {
+      res = -(int)i;
+    } else if (!matches_fresh_parse(path)) {
+      // Again, answered from the state alone.
+      res = -100 - (int)i;
+    }
+  }
+
+  remove_input(path);
+  free(input);
+  return res;
+}
+
+int torn_state() {
+  char* input   = generate_input();
+  size_t length = strlen(input);
+  char path[]   = "/tmp/day01_state_test_XXXXXX";
+  close(mkstemp(path));
+
+  // State is only kept for whole lines.
+  int res     = 0;
+  size_t half = end_of_line(input, length, length / 2);
+  append_to_file(path, input, half);
+  free(answers(path, true));
+
+  // A run torn off the end of the state file - left by a crash while
+  // appending it - before and after more is appended.
+  char state[256];
+  snprintf(state, sizeof(state), "%s.day01.cache", path);
+  uint64_t torn[] = {1000, 1, 2, 3};
+  append_to_file(state, (char*)torn, sizeof(torn));
+  if (!matches_fresh_parse(path)) {
+    res = -1;
+  }
+  append_to_file(state, (char*)torn, sizeof(torn));
+  append_to_file(path, input + half, length - half);
+  if (res == 0 && !matches_fresh_parse(path)) {
+    res = -2;
+  }
+
+  remove_input(path);
+  free(input);
+  return res;
+}
+
+int edited_input() {
+  char* input   = generate_input();
+  size_t length = strlen(input);
+  char path[]   = "/tmp/day01_state_test_XXXXXX";
+  close(mkstemp(path));
+
+  // State is only kept for whole lines.
+  int res     = 0;
+  size_t half = end_of_line(input, length, length / 2);
+  append_to_file(path, input, half);
+  free(answers(path, true));
+
+  // Change a digit in the middle, then append - what was kept is no
+  // longer a prefix of the input.
+  size_t middle = half / 2;
+  while (input[middle] < '1' || input[middle] > '8') {
+    middle += 1;
+  }
+  char digit = input[middle] + 1;
+  int fd     = open(path, O_WRONLY);
+  assert(pwrite(fd, &digit, 1, middle) == 1);
+  close(fd);
+  append_to_file(path, input + half, length - half);
+  if (!matches_fresh_parse(path)) {
+    res = -1;
+  }
+
+  remove_input(path);
+  free(input);
+  return res;
+}
+
+int main(int argc, char** argv) {
+  printf("Running Tests\n");
+  printf("-------------\n");
+  run_test("appends", appends);
+  run_test("torn_state", torn_state);
+  run_test("edited_input", edited_input);
+
+  return 0;
+}
@@ -1,4 +1,5 @@
 #include <assert.h>
+#include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 
@@ -81,6 +82,207 @@ int array_of_arrays() {
   return 0;
 }
 
+int reserve_and_shrink() {
+  dyn_array* arr = init_dyn_array(UINT64);
+
+  reserve_dyn_array(arr, BIG_ARRAY_SIZE);
+  size_t reserved = arr->allocated;
+  assert(reserved >= BIG_ARRAY_SIZE);
+
+  for (size_t i = 0; i < BIG_ARRAY_SIZE; i += 1) {
+    push_onto_dyn_array(arr, (void*)i);
+  }
+  if (arr->allocated != reserved) {
+    return -1;
+  }
+
+  push_onto_dyn_array(arr, (void*)BIG_ARRAY_SIZE);
+  shrink_dyn_array_to_fit(arr);
+  if (arr->allocated != BIG_ARRAY_SIZE + 1) {
+    return -2;
+  }
+
+  for (size_t i = 0; i <= BIG_ARRAY_SIZE; i += 1) {
+    assert((uint64_t)get_element_of_dyn_array(arr, i) == i);
+  }
+
+  free_dyn_array(arr);
+  return 0;
+}
+
+int bulk_append() {
+  uint64_t values[BIG_ARRAY_SIZE];
+  for (size_t i = 0; i < BIG_ARRAY_SIZE; i += 1) {
+    values[i] = i;
+  }
+
+  dyn_array* arr = init_dyn_array(UINT64);
+  append_uint64s_onto_dyn_array(arr, values, BIG_ARRAY_SIZE);
+  assert(arr->occupied == BIG_ARRAY_SIZE);
+
+  // Appending an array onto itself doubles it up.
+  append_dyn_array_onto_dyn_array(arr, arr);
+  assert(arr->occupied == 2 * BIG_ARRAY_SIZE);
+  for (size_t i = 0; i < 2 * BIG_ARRAY_SIZE; i += 1) {
+    if ((uint64_t)get_element_of_dyn_array(arr, i) != i % BIG_ARRAY_SIZE) {
+      return -1;
+    }
+  }
+
+  // Arrays of arrays get deep copies.
+  dyn_array* outer = init_dyn_array(DYN_ARRAY);
+  push_onto_dyn_array(outer, arr);
+  dyn_array* other = init_dyn_array(DYN_ARRAY);
+  append_dyn_array_onto_dyn_array(other, outer);
+  free_dyn_array(outer);
+  dyn_array* inner = get_element_of_dyn_array(other, 0);
+  assert(inner != arr && inner->occupied == arr->occupied);
+
+  free_dyn_array(other);
+  free_dyn_array(arr);
+  return 0;
+}
+
+int growth_policy() {
+  dyn_array* arr = init_dyn_array(UINT64);
+  set_growth_policy_of_dyn_array(arr, 1.5, 0.75);
+
+  for (size_t i = 0; i < BIG_ARRAY_SIZE; i += 1) {
+    push_onto_dyn_array(arr, (void*)i);
+    if (arr->occupied > arr->allocated * 0.75) {
+      return -1;
+    }
+  }
+
+  // Copies keep the policy, without the spare capacity.
+  dyn_array* copy = copy_dyn_array(arr);
+  assert(copy->growth_factor == 1.5 && copy->fill_threshold == 0.75);
+  assert(copy->allocated < arr->allocated);
+
+  free_dyn_array(copy);
+  free_dyn_array(arr);
+  return 0;
+}
+
+bool is_odd(const void* el, void* context) { return (uint64_t)el % 2 == 1; }
+
+int erase_in_one_pass() {
+  dyn_array* arr = init_dyn_array(UINT64);
+  for (size_t i = 0; i < BIG_ARRAY_SIZE; i += 1) {
+    push_onto_dyn_array(arr, (void*)i);
+  }
+
+  // Keep the evens.
+  if (erase_if_in_dyn_array(arr, is_odd, NULL) != BIG_ARRAY_SIZE / 2) {
+    return -1;
+  }
+  for (size_t i = 0; i < arr->occupied; i += 1) {
+    assert((uint64_t)get_element_of_dyn_array(arr, i) == 2 * i);
+  }
+
+  // Drop the first half of those, so the multiples of four from half way.
+  assert(erase_range_of_dyn_array(arr, 0, BIG_ARRAY_SIZE / 4) ==
+         BIG_ARRAY_SIZE / 4);
+  assert(erase_range_of_dyn_array(arr, arr->occupied, arr->occupied + 1) == 0);
+
+  // Every other remaining index, with a repeat and one past the end.
+  dyn_array* indices = init_dyn_array(UINT64);
+  for (size_t i = 0; i < arr->occupied; i += 2) {
+    push_onto_dyn_array(indices, (void*)i);
+    if (i == 4) {
+      push_onto_dyn_array(indices, (void*)i);
+    }
+  }
+  push_onto_dyn_array(indices, (void*)arr->occupied);
+  if (erase_indices_of_dyn_array(arr, indices) != BIG_ARRAY_SIZE / 8) {
+    return -1;
+  }
+  for (size_t i = 0; i < arr->occupied; i += 1) {
+    uint64_t expected = BIG_ARRAY_SIZE / 2 + 2 + 4 * i;
+    assert((uint64_t)get_element_of_dyn_array(arr, i) == expected);
+  }
+
+  // The last element takes the place of the first.
+  uint64_t last = (uint64_t)get_element_of_dyn_array(arr, arr->occupied - 1);
+  assert(swap_remove_element_of_dyn_array(arr, 0));
+  assert((uint64_t)get_element_of_dyn_array(arr, 0) == last);
+  assert(!swap_remove_element_of_dyn_array(arr, arr->occupied));
+
+  free_dyn_array(indices);
+  free_dyn_array(arr);
+  return 0;
+}
+
+int erase_frees_arrays() {
+  dyn_array* arr = init_dyn_array(DYN_ARRAY);
+  for (size_t i = 0; i < BIG_ARRAY_SIZE; i += 1) {
+    dyn_array* inner = init_dyn_array(UINT64);
+    push_onto_dyn_array(inner, (void*)i);
+    push_onto_dyn_array(arr, inner);
+    free_dyn_array(inner);
+  }
+
+  // Removed arrays are freed, rather than leaked.
+  remove_element_of_dyn_array(arr, 0);
+  swap_remove_element_of_dyn_array(arr, 0);
+  erase_range_of_dyn_array(arr, 0, 10);
+  assert(arr->occupied == BIG_ARRAY_SIZE - 12);
+
+  dyn_array* first = get_element_of_dyn_array(arr, 0);
+  assert((uint64_t)get_element_of_dyn_array(first, 0) == 11);
+
+  free_dyn_array(arr);
+  return 0;
+}
+
+int hash_by_contents() {
+  dyn_array* a = init_dyn_array(UINT64);
+  dyn_array* b = init_dyn_array(UINT64);
+  for (uint64_t i = 0; i < 100; i += 1) {
+    push_onto_dyn_array(a, (void*)(i * i));
+  }
+  append_dyn_array_onto_dyn_array(b, a);
+
+  int res = 0;
+  if (hash_of_dyn_array(a) != hash_of_dyn_array(b) ||
+      !equal_dyn_arrays(a, b)) {
+    res = -1;
+  }
+
+  // The kept hash follows changes.
+  push_onto_dyn_array(b, (void*)7);
+  if (res == 0 && (hash_of_dyn_array(a) == hash_of_dyn_array(b) ||
+                   equal_dyn_arrays(a, b))) {
+    res = -2;
+  }
+  remove_element_of_dyn_array(b, 100);
+  if (res == 0 && hash_of_dyn_array(a) != hash_of_dyn_array(b)) {
+    res = -3;
+  }
+
+  // Arrays of arrays hash by their elements' contents.
+  dyn_array* outer_a = init_dyn_array(DYN_ARRAY);
+  dyn_array* outer_b = init_dyn_array(DYN_ARRAY);
+  push_onto_dyn_array(outer_a, a);
+  push_onto_dyn_array(outer_b, b);
+  if (res == 0 && (hash_of_dyn_array(outer_a) != hash_of_dyn_array(outer_b) ||
+                   !equal_dyn_arrays(outer_a, outer_b))) {
+    res = -4;
+  }
+  sort_dyn_array(get_element_of_dyn_array(outer_b, 0));
+  swap_remove_element_of_dyn_array(get_element_of_dyn_array(outer_b, 0), 0);
+  if (res == 0 && (hash_of_dyn_array(outer_a) == hash_of_dyn_array(outer_b) ||
+                   equal_dyn_arrays(outer_a, outer_b))) {
+    res = -5;
+  }
+
+  free_dyn_array(outer_a);
+  free_dyn_array(outer_b);
+  free_dyn_array(a);
+  free_dyn_array(b);
+  return res;
+}
+
 int main(int argc, char** argv) {
   printf("Running Tests\n");
   printf("-------------\n");
@@ -88,6 +290,12 @@ int main(int argc, char** argv) {
   run_test("make_a_big_one_and_remove_everything",
            make_a_big_one_and_remove_everything);
   run_test("array_of_arrays", array_of_arrays);
+  run_test("reserve_and_shrink", reserve_and_shrink);
+  run_test("bulk_append", bulk_append);
+  run_test("growth_policy", growth_policy);
+  run_test("erase_in_one_pass", erase_in_one_pass);
+  run_test("erase_frees_arrays", erase_frees_arrays);
+  run_test("hash_by_contents", hash_by_contents);
 
   return 0;
 }
@@ -0,0 +1,217 @@
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "../include/dyn_array.h"
+#include "../include/hash_table.h"
+
+#define BIG_TABLE_SIZE 100000
+
+void run_test(char* name, int (*test)()) {
+  printf("- %s\n", name);
+  int res = test();
+  printf(" - result: %d\n", res);
+}
+
+int make_a_big_one() {
+  hash_table* table = init_hash_table(UINT64, UINT64);
+
+  for (uint64_t i = 1; i <= BIG_TABLE_SIZE; i += 1) {
+    set_entry_in_hash_table(table, (void*)i, (void*)(2 * i));
+  }
+  // Overwrite some.
+  for (uint64_t i = 1; i <= BIG_TABLE_SIZE; i += 7) {
+    set_entry_in_hash_table(table, (void*)i, (void*)(3 * i));
+  }
+
+  assert(table->occupied == BIG_TABLE_SIZE);
+  for (uint64_t i = 1; i <= BIG_TABLE_SIZE; i += 1) {
+    uint64_t expected = (i - 1) % 7 == 0 ? 3 * i : 2 * i;
+    if ((uint64_t)get_entry_in_hash_table(table, (void*)i) != expected) {
+      return -1;
+    }
+  }
+  assert(get_entry_in_hash_table(table, (void*)(BIG_TABLE_SIZE + 1)) == NULL);
+
+  free_hash_table(table);
+  return 0;
+}
+
+int wrap_around() {
+  hash_table* table = init_hash_table(UINT64, UINT64);
+
+  // All hash to the last index, so the later ones wrap to the front.
+  uint64_t last   = HASH_TABLE_INIT_SIZE - 1;
+  uint64_t keys[] = {last, last + HASH_TABLE_INIT_SIZE,
+                     last + 2 * HASH_TABLE_INIT_SIZE};
+  for (size_t i = 0; i < 3; i += 1) {
+    set_entry_in_hash_table(table, (void*)keys[i], (void*)(i + 1));
+  }
+  assert(table->allocated == HASH_TABLE_INIT_SIZE);
+
+  for (size_t i = 0; i < 3; i += 1) {
+    if ((uint64_t)get_entry_in_hash_table(table, (void*)keys[i]) != i + 1) {
+      return -1;
+    }
+  }
+
+  // Removing from the last index shifts the wrapped entries back.
+  assert(remove_entry_in_hash_table(table, (void*)keys[0]));
+  for (size_t i = 1; i < 3; i += 1) {
+    if ((uint64_t)get_entry_in_hash_table(table, (void*)keys[i]) != i + 1) {
+      return -1;
+    }
+  }
+
+  free_hash_table(table);
+  return 0;
+}
+
+int shrink_and_reserve() {
+  hash_table* table = init_hash_table_with_capacity(UINT64, UINT64, 1000);
+  size_t presized   = table->allocated;
+  for (uint64_t i = 1; i <= 1000; i += 1) {
+    set_entry_in_hash_table(table, (void*)i, (void*)i);
+  }
+  assert(table->allocated == presized);
+
+  for (uint64_t i = 1001; i <= BIG_TABLE_SIZE; i += 1) {
+    set_entry_in_hash_table(table, (void*)i, (void*)i);
+  }
+  size_t grown = table->allocated;
+
+  // Removing most keys shrinks the table, down to the reservation.
+  for (uint64_t i = 11; i <= BIG_TABLE_SIZE; i += 1) {
+    assert(remove_entry_in_hash_table(table, (void*)i));
+  }
+  assert(table->allocated < grown && table->allocated == presized);
+
+  for (uint64_t i = 1; i <= 10; i += 1) {
+    if ((uint64_t)get_entry_in_hash_table(table, (void*)i) != i) {
+      return -1;
+    }
+  }
+
+  // Compacting drops the reservation.
+  compact_hash_table(table);
+  assert(table->allocated == HASH_TABLE_INIT_SIZE * 2);
+  for (uint64_t i = 1; i <= 10; i += 1) {
+    if ((uint64_t)get_entry_in_hash_table(table, (void*)i) != i) {
+      return -1;
+    }
+  }
+
+  reserve_hash_table(table, 1000);
+  assert(table->allocated == presized);
+
+  free_hash_table(table);
+  return 0;
+}
+
+int values_survive_resizing() {
+  hash_table* table = init_hash_table(UINT64, DYN_ARRAY);
+
+  for (uint64_t i = 1; i <= 1000; i += 1) {
+    dyn_array* arr = init_dyn_array(UINT64);
+    push_onto_dyn_array(arr, (void*)i);
+    set_entry_in_hash_table(table, (void*)i, arr);
+    free_dyn_array(arr);
+  }
+  for (uint64_t i = 1; i <= 990; i += 1) {
+    remove_entry_in_hash_table(table, (void*)i);
+  }
+
+  for (uint64_t i = 991; i <= 1000; i += 1) {
+    dyn_array* arr = get_entry_in_hash_table(table, (void*)i);
+    if ((uint64_t)get_element_of_dyn_array(arr, 0) != i) {
+      return -1;
+    }
+  }
+
+  free_hash_table(table);
+  return 0;
+}
+
+int stats_reports() {
+  hash_table* table = init_hash_table(UINT64, UINT64);
+  for (uint64_t i = 1; i <= 100; i += 1) {
+    set_entry_in_hash_table(table, (void*)(i * HASH_TABLE_INIT_SIZE), NULL);
+  }
+  get_entry_in_hash_table(table, (void*)1);
+
+  char* pp   = pp_hash_table_stats(table);
+  char* json = json_of_hash_table_stats(table);
+  int res    = 0;
+  if (strstr(pp, "occupied: 100 / 256") == NULL ||
+      strstr(json, "\"occupied\": 100, \"allocated\": 256") == NULL ||
+      json[strlen(json) - 1] != '}') {
+    res = -1;
+  }
+
+#ifdef HASH_TABLE_STATS
+  if (table->stats.inserts != 100 || table->stats.misses != 1 ||
+      table->stats.grows != 4) {
+    res = -1;
+  }
+#endif
+
+  free(pp);
+  free(json);
+  free_hash_table(table);
+  return res;
+}
+
+int dyn_array_keys() {
+  hash_table* table = init_hash_table(DYN_ARRAY, UINT64);
+
+  // Keys are looked up by contents, through arrays built separately.
+  for (uint64_t i = 1; i <= 1000; i += 1) {
+    dyn_array* key = init_dyn_array(UINT64);
+    for (uint64_t j = 0; j <= i % 7; j += 1) {
+      push_onto_dyn_array(key, (void*)(i + j));
+    }
+    set_entry_in_hash_table(table, key, (void*)i);
+    free_dyn_array(key);
+  }
+
+  int res        = table->occupied == 1000 ? 0 : -1;
+  dyn_array* key = init_dyn_array(UINT64);
+  for (uint64_t i = 1; i <= 1000 && res == 0; i += 1) {
+    erase_range_of_dyn_array(key, 0, key->occupied);
+    for (uint64_t j = 0; j <= i % 7; j += 1) {
+      push_onto_dyn_array(key, (void*)(i + j));
+    }
+    if ((uint64_t)get_entry_in_hash_table(table, key) != i) {
+      res = -2;
+    }
+  }
+
+  // Setting an equal key updates its value, and removing frees it.
+  set_entry_in_hash_table(table, key, (void*)1);
+  if (res == 0 && (table->occupied != 1000 ||
+                   (uint64_t)get_entry_in_hash_table(table, key) != 1)) {
+    res = -3;
+  }
+  if (res == 0 && (!remove_entry_in_hash_table(table, key) ||
+                   get_entry_in_hash_table(table, key) != NULL)) {
+    res = -4;
+  }
+
+  free_dyn_array(key);
+  free_hash_table(table);
+  return res;
+}
+
+int main(int argc, char** argv) {
+  printf("Running Tests\n");
+  printf("-------------\n");
+  run_test("make_a_big_one", make_a_big_one);
+  run_test("wrap_around", wrap_around);
+  run_test("shrink_and_reserve", shrink_and_reserve);
+  run_test("values_survive_resizing", values_survive_resizing);
+  run_test("stats_reports", stats_reports);
+  run_test("dyn_array_keys", dyn_array_keys);
+
+  return 0;
+}
@@ -0,0 +1,75 @@
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "../include/dyn_array.h"
+#include "../include/hyperloglog.h"
+
+void run_test(char* name, int (*test)()) {
+  printf("- %s\n", name);
+  int res = test();
+  printf(" - result: %d\n", res);
+}
+
+// Return whether ESTIMATE is within 5% (or 1, for tiny counts) of ACTUAL.
+bool is_close(size_t estimate, size_t actual) {
+  size_t diff = estimate > actual ? estimate - actual : actual - estimate;
+  return diff <= 1 || diff * 20 <= actual;
+}
+
+int estimates_are_close() {
+  for (size_t distinct = 1; distinct <= 1000000; distinct *= 10) {
+    dyn_array* arr = init_dyn_array(UINT64);
+    // Every value three times, strided so they are not consecutive.
+    for (size_t copy = 0; copy < 3; copy += 1) {
+      for (uint64_t i = 0; i < distinct; i += 1) {
+        push_onto_dyn_array(arr, (void*)(i * 7919));
+      }
+    }
+
+    size_t estimate = estimate_distinct_in_dyn_array(arr);
+    free_dyn_array(arr);
+    if (!is_close(estimate, distinct)) {
+      printf("   %lu distinct estimated as %lu\n", distinct, estimate);
+      return -1;
+    }
+  }
+
+  hyperloglog* hll = init_hyperloglog(HYPERLOGLOG_PRECISION);
+  assert(estimate_of_hyperloglog(hll) == 0);
+  free_hyperloglog(hll);
+  return 0;
+}
+
+int merging() {
+  hyperloglog* evens = init_hyperloglog(HYPERLOGLOG_PRECISION);
+  hyperloglog* odds  = init_hyperloglog(HYPERLOGLOG_PRECISION);
+  for (uint64_t i = 0; i < 100000; i += 2) {
+    uint64_t even = i;
+    uint64_t odd  = i + 1;
+    add_uint64s_to_hyperloglog(evens, &even, 1);
+    add_uint64s_to_hyperloglog(odds, &odd, 1);
+  }
+
+  merge_hyperloglogs(evens, odds);
+  int res = is_close(estimate_of_hyperloglog(evens), 100000) ? 0 : -1;
+
+  // Merging what was already seen changes nothing.
+  size_t before = estimate_of_hyperloglog(evens);
+  merge_hyperloglogs(evens, odds);
+  assert(estimate_of_hyperloglog(evens) == before);
+
+  free_hyperloglog(evens);
+  free_hyperloglog(odds);
+  return res;
+}
+
+int main(int argc, char** argv) {
+  printf("Running Tests\n");
+  printf("-------------\n");
+  run_test("estimates_are_close", estimates_are_close);
+  run_test("merging", merging);
+
+  return 0;
+}
@@ -0,0 +1,414 @@
+#include <assert.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../include/input_cache.h"
+
+void run_test(char* name, int (*test)()) {
+  printf("- %s\n", name);
+  int res = test();
+  printf(" - result: %d\n", res);
+}
+
+// Write CONTENT to a fresh temporary file at PATH, a mkstemp template.
+void temporary_input(char* path, const char* content) {
+  int fd = mkstemp(path);
+  assert(write(fd, content, strlen(content)) == (ssize_t)strlen(content));
+  close(fd);
+}
+
+// Append CONTENT to the file at PATH.
+void append_to_file(const char* path, const char* content) {
+  int fd = open(path, O_WRONLY | O_APPEND);
+  assert(write(fd, content, strlen(content)) == (ssize_t)strlen(content));
+  close(fd);
+}
+
+// Write the "test" cache of INPUT_PATH, with two columns per block:
+// three blocks, the Bth holding B + 1 values in the first column and
+// none in the second.
+void write_test_cache(const char* input_path) {
+  input_cache_writer* writer = init_input_cache_writer(input_path, "test", 2);
+  assert(writer != NULL);
+  uint64_t values[] = {10, 20, 30};
+  for (size_t b = 0; b < 3; b += 1) {
+    const uint64_t* columns[2] = {values, NULL};
+    size_t lengths[2]          = {b + 1, 0};
+    append_block_to_input_cache(writer, columns, lengths);
+  }
+  finish_input_cache(writer);
+}
+
+// Write the path of the "test" cache of INPUT_PATH into PATH.
+void test_cache_path(const char* input_path, char* path, size_t length) {
+  snprintf(path, length, "%s.test.cache", input_path);
+}
+
+// Return whether CACHE holds just what write_test_cache writes.
+bool holds_test_blocks(input_cache* cache) {
+  if (cache->num_blocks != 3) {
+    return false;
+  }
+  for (size_t b = 0; b < 3; b += 1) {
+    if (cache->blocks[b].lengths[0] != b + 1 ||
+        cache->blocks[b].lengths[1] != 0 ||
+        cache->blocks[b].columns[0][b] != 10 * (b + 1)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Remove the input at INPUT_PATH and its "test" cache.
+void remove_test_files(const char* input_path) {
+  char path[256];
+  test_cache_path(input_path, path, sizeof(path));
+  unlink(path);
+  unlink(input_path);
+}
+
+int round_trip() {
+  char input[] = "/tmp/input_cache_test_XXXXXX";
+  temporary_input(input, "1 2\n3 4\n");
+  write_test_cache(input);
+
+  int res            = 0;
+  input_cache* cache = load_input_cache(input, "test", 2);
+  if (cache == NULL) {
+    res = -1;
+  } else if (!holds_test_blocks(cache) || !verify_input_cache(cache)) {
+    res = -2;
+  }
+  if (cache != NULL) {
+    free_input_cache(cache);
+  }
+
+  remove_test_files(input);
+  return res;
+}
+
+// Overwrite the header of the "test" cache of INPUT_PATH with TAMPER
+// applied to it, keeping the header checksum right unless BREAK_CHECKSUM.
+void tamper_with_header(const char* input_path,
+                        void (*tamper)(input_cache_header* header),
+                        bool break_checksum) {
+  char path[256];
+  test_cache_path(input_path, path, sizeof(path));
+  int fd = open(path, O_RDWR);
+
+  input_cache_header header;
+  assert(pread(fd, &header, sizeof(header), 0) == sizeof(header));
+  tamper(&header);
+  header.header_checksum = checksum_of_header(&header);
+  if (break_checksum) {
+    header.header_checksum ^= 1;
+  }
+  assert(pwrite(fd, &header, sizeof(header), 0) == sizeof(header));
+  close(fd);
+}
+
+void keep_header(input_cache_header* header) {}
+
+void bump_version(input_cache_header* header) {
+  header->version += 1;
+}
+
+void rename_kind(input_cache_header* header) {
+  header->kind[0] = 'T';
+}
+
+int rejects_mismatches() {
+  char input[] = "/tmp/input_cache_test_XXXXXX";
+  temporary_input(input, "1 2\n3 4\n");
+
+  // A cache of another kind, or with other columns, is not this one.
+  int res = 0;
+  write_test_cache(input);
+  if (load_input_cache(input, "other", 2) != NULL ||
+      load_input_cache(input, "test", 3) != NULL) {
+    res = -1;
+  }
+
+  // Nor is one claiming another version or kind with a valid header
+  // checksum, or an untouched one with a broken header checksum.
+  void (*tampers[])(input_cache_header*) = {bump_version, rename_kind,
+                                            keep_header};
+  for (size_t i = 0; i < 3 && res == 0; i += 1) {
+    write_test_cache(input);
+    tamper_with_header(input, tampers[i], tampers[i] == keep_header);
+    if (load_input_cache(input, "test", 2) != NULL) {
+      res = -2 - (int)i;
+    }
+  }
+
+  remove_test_files(input);
+  return res;
+}
+
+int rejects_truncated() {
+  char input[] = "/tmp/input_cache_test_XXXXXX";
+  temporary_input(input, "1 2\n3 4\n");
+  write_test_cache(input);
+
+  // Cut the last block short.
+  char path[256];
+  test_cache_path(input, path, sizeof(path));
+  int fd     = open(path, O_RDWR);
+  off_t size = lseek(fd, 0, SEEK_END);
+  int res    = ftruncate(fd, size - sizeof(uint64_t)) == 0 ? 0 : -1;
+  close(fd);
+
+  if (res == 0 && load_input_cache(input, "test", 2) != NULL) {
+    res = -2;
+  }
+
+  remove_test_files(input);
+  return res;
+}
+
+int rejects_changed_input() {
+  char input[] = "/tmp/input_cache_test_XXXXXX";
+  temporary_input(input, "1 2\n3 4\n");
+  write_test_cache(input);
+
+  // Grown, the input is no longer the one cached - though what was
+  // cached is still a prefix of it.
+  int res = 0;
+  append_to_file(input, "5 6\n");
+  if (load_input_cache(input, "test", 2) != NULL) {
+    res = -1;
+  }
+  input_cache* prefix = load_input_cache_of_prefix(input, "test", 2);
+  if (res == 0 && (prefix == NULL || prefix->header->input_size != 8)) {
+    res = -2;
+  }
+  if (prefix != NULL) {
+    free_input_cache(prefix);
+  }
+
+  // Edited in place, it is not even that.
+  write_test_cache(input);
+  int fd = open(input, O_WRONLY);
+  assert(pwrite(fd, "9", 1, 2) == 1);
+  close(fd);
+  if (res == 0 && (load_input_cache(input, "test", 2) != NULL ||
+                   load_input_cache_of_prefix(input, "test", 2) != NULL)) {
+    res = -3;
+  }
+
+  remove_test_files(input);
+  return res;
+}
+
+int rejects_edited_prefix() {
+  // An input long enough that its middle is far from either sampled end.
+  size_t length = 4 * INPUT_CACHE_SAMPLE_SIZE;
+  char* content = malloc(length + 1);
+  for (size_t i = 0; i < length; i += 4) {
+    memcpy(content + i, "1 2\n", 4);
+  }
+  content[length] = '\0';
+
+  char input[] = "/tmp/input_cache_test_XXXXXX";
+  temporary_input(input, content);
+  free(content);
+
+  // Appended to, what was cached is still a prefix of the input.
+  int res = 0;
+  write_test_cache(input);
+  append_to_file(input, "5 6\n");
+  input_cache* prefix = load_input_cache_of_prefix(input, "test", 2);
+  if (prefix == NULL || prefix->header->input_size != length) {
+    res = -1;
+  }
+  if (prefix != NULL) {
+    free_input_cache(prefix);
+  }
+
+  // Edited in the middle and then appended to, it is not.
+  write_test_cache(input);
+  int fd = open(input, O_WRONLY);
+  assert(pwrite(fd, "3", 1, length / 2) == 1);
+  close(fd);
+  append_to_file(input, "7 8\n");
+  if (res == 0 && load_input_cache_of_prefix(input, "test", 2) != NULL) {
+    res = -2;
+  }
+
+  remove_test_files(input);
+  return res;
+}
+
+// Return the inode of the "test" cache of INPUT_PATH, and set SIZE to
+// its size.
+ino_t test_cache_inode(const char* input_path, off_t* size) {
+  char path[256];
+  test_cache_path(input_path, path, sizeof(path));
+  struct stat st;
+  assert(stat(path, &st) == 0);
+  *size = st.st_size;
+  return st.st_ino;
+}
+
+// Return whether the "test" cache of INPUT_PATH, loaded as a prefix,
+// holds NUM_BLOCKS blocks, the Bth being the single value B in the
+// first column, and covers SIZE bytes of the input.
+bool holds_appended_blocks(const char* input_path, size_t num_blocks,
+                           uint64_t size) {
+  input_cache* cache = load_input_cache_of_prefix(input_path, "test", 2);
+  if (cache == NULL) {
+    return false;
+  }
+  bool holds = cache->num_blocks == num_blocks &&
+               cache->header->input_size == size && verify_input_cache(cache);
+  for (size_t b = 0; holds && b < num_blocks; b += 1) {
+    holds = cache->blocks[b].lengths[0] == 1 &&
+            cache->blocks[b].lengths[1] == 0 &&
+            cache->blocks[b].columns[0][0] == b;
+  }
+  free_input_cache(cache);
+  return holds;
+}
+
+// Append LINE to the input at INPUT_PATH, and a block for all of the
+// input the "test" cache does not yet cover - the cache has to load as
+// a prefix of the input. Return whether the cache could be appended to.
+bool append_line_and_block(const char* input_path, const char* line) {
+  input_cache* cache = load_input_cache_of_prefix(input_path, "test", 2);
+  if (cache == NULL) {
+    return false;
+  }
+  append_to_file(input_path, line);
+  struct stat st;
+  assert(stat(input_path, &st) == 0);
+  uint64_t value = cache->num_blocks;
+
+  input_cache_writer* writer =
+      init_input_cache_appender(cache, input_path, "test", st.st_size);
+  free_input_cache(cache);
+  if (writer == NULL) {
+    return false;
+  }
+  const uint64_t* columns[2] = {&value, NULL};
+  size_t lengths[2]          = {1, 0};
+  append_block_to_input_cache(writer, columns, lengths);
+  finish_input_cache(writer);
+  return true;
+}
+
+int appends_in_place() {
+  char input[] = "/tmp/input_cache_test_XXXXXX";
+  temporary_input(input, "0 0\n");
+
+  input_cache_writer* writer =
+      init_input_cache_writer_of_prefix(input, "test", 2, 4);
+  uint64_t value             = 0;
+  const uint64_t* columns[2] = {&value, NULL};
+  size_t lengths[2]          = {1, 0};
+  append_block_to_input_cache(writer, columns, lengths);
+  finish_input_cache(writer);
+
+  // Each append extends the one cache file, and what it holds matches
+  // what a fresh cache would.
+  int res = 0;
+  off_t size;
+  ino_t inode = test_cache_inode(input, &size);
+  for (size_t b = 1; b < 5 && res == 0; b += 1) {
+    off_t grown;
+    if (!append_line_and_block(input, "1 1\n")) {
+      res = -1;
+    } else if (test_cache_inode(input, &grown) != inode ||
+               grown != size + 3 * sizeof(uint64_t)) {
+      res = -2;
+    } else if (!holds_appended_blocks(input, b + 1, 4 * (b + 1))) {
+      res = -3;
+    }
+    size = grown;
+  }
+
+  // A partial line appended to the input does not disturb the cache of
+  // the lines before it.
+  append_to_file(input, "2 ");
+  if (res == 0 && !holds_appended_blocks(input, 5, 20)) {
+    res = -4;
+  }
+
+  // A block torn off by a crash while appending is ignored, and then
+  // written over by the next append.
+  char path[256];
+  test_cache_path(input, path, sizeof(path));
+  uint64_t torn[] = {5, 7, 7, 7};
+  int fd          = open(path, O_WRONLY | O_APPEND);
+  assert(write(fd, torn, sizeof(torn)) == sizeof(torn));
+  close(fd);
+  if (res == 0 && !holds_appended_blocks(input, 5, 20)) {
+    res = -5;
+  }
+  if (res == 0 && (!append_line_and_block(input, "2\n") ||
+                   !holds_appended_blocks(input, 6, 24))) {
+    res = -6;
+  }
+  off_t appended;
+  test_cache_inode(input, &appended);
+  if (res == 0 && appended != size + 3 * sizeof(uint64_t)) {
+    res = -7;
+  }
+
+  remove_test_files(input);
+  return res;
+}
+
+int verify_catches_flipped_byte() {
+  char input[] = "/tmp/input_cache_test_XXXXXX";
+  temporary_input(input, "1 2\n3 4\n");
+  write_test_cache(input);
+
+  // Flip a bit of the last value of the last block.
+  char path[256];
+  test_cache_path(input, path, sizeof(path));
+  int fd     = open(path, O_RDWR);
+  off_t last = lseek(fd, 0, SEEK_END) - 2 * sizeof(uint64_t);
+  char byte;
+  assert(pread(fd, &byte, 1, last) == 1);
+  byte ^= 4;
+  assert(pwrite(fd, &byte, 1, last) == 1);
+  close(fd);
+
+  // Loading looks at no values, verifying at all of them.
+  int res            = 0;
+  input_cache* cache = load_input_cache(input, "test", 2);
+  if (cache == NULL) {
+    res = -1;
+  } else if (verify_input_cache(cache)) {
+    res = -2;
+  }
+  if (cache != NULL) {
+    free_input_cache(cache);
+  }
+
+  remove_test_files(input);
+  return res;
+}
+
+int main(int argc, char** argv) {
+  setenv("AOC_INPUT_CACHE", "1", 1);
+
+  printf("Running Tests\n");
+  printf("-------------\n");
+  run_test("round_trip", round_trip);
+  run_test("rejects_mismatches", rejects_mismatches);
+  run_test("rejects_truncated", rejects_truncated);
+  run_test("rejects_changed_input", rejects_changed_input);
+  run_test("rejects_edited_prefix", rejects_edited_prefix);
+  run_test("appends_in_place", appends_in_place);
+  run_test("verify_catches_flipped_byte", verify_catches_flipped_byte);
+
+  return 0;
+}
@@ -0,0 +1,166 @@
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "../include/dyn_array.h"
+#include "../include/join.h"
+
+#define BIG_ARRAY_SIZE 1000
+
+void run_test(char* name, int (*test)()) {
+  printf("- %s\n", name);
+  int res = test();
+  printf(" - result: %d\n", res);
+}
+
+// The quadratic definition of a multiplicity join, for reference.
+join_result brute_force_join(dyn_array* lefts, dyn_array* rights) {
+  join_result result = {0, 0};
+  for (size_t i = 0; i < lefts->occupied; i += 1) {
+    uint64_t l = (uint64_t)get_element_of_dyn_array(lefts, i);
+    for (size_t j = 0; j < rights->occupied; j += 1) {
+      uint64_t r = (uint64_t)get_element_of_dyn_array(rights, j);
+      if (l == r) {
+        result.count += 1;
+        result.weighted_sum += l;
+      }
+    }
+  }
+  return result;
+}
+
+int check_all_joins(dyn_array* lefts, dyn_array* rights) {
+  sort_dyn_array(lefts);
+  sort_dyn_array(rights);
+
+  join_result expected = brute_force_join(lefts, rights);
+
+  uint64_t* l = (uint64_t*)lefts->data;
+  uint64_t* r = (uint64_t*)rights->data;
+  join_result merged =
+      merge_join_sorted_uint64(l, lefts->occupied, r, rights->occupied);
+  join_result galloped =
+      gallop_join_sorted_uint64(l, lefts->occupied, r, rights->occupied);
+  join_result chosen = join_sorted_dyn_arrays(lefts, rights);
+
+  if (merged.count != expected.count ||
+      merged.weighted_sum != expected.weighted_sum) {
+    return -1;
+  }
+  if (galloped.count != expected.count ||
+      galloped.weighted_sum != expected.weighted_sum) {
+    return -2;
+  }
+  if (chosen.count != expected.count ||
+      chosen.weighted_sum != expected.weighted_sum) {
+    return -3;
+  }
+  return 0;
+}
+
+int practice_input() {
+  uint64_t ls[] = {3, 4, 2, 1, 3, 3};
+  uint64_t rs[] = {4, 3, 5, 3, 9, 3};
+
+  dyn_array* lefts  = init_dyn_array(UINT64);
+  dyn_array* rights = init_dyn_array(UINT64);
+  for (size_t i = 0; i < 6; i += 1) {
+    push_onto_dyn_array(lefts, (void*)ls[i]);
+    push_onto_dyn_array(rights, (void*)rs[i]);
+  }
+
+  int res = check_all_joins(lefts, rights);
+  assert(join_sorted_dyn_arrays(lefts, rights).weighted_sum == 31);
+
+  free_dyn_array(lefts);
+  free_dyn_array(rights);
+  return res;
+}
+
+int duplicate_heavy() {
+  dyn_array* lefts  = init_dyn_array(UINT64);
+  dyn_array* rights = init_dyn_array(UINT64);
+  for (size_t i = 0; i < BIG_ARRAY_SIZE; i += 1) {
+    push_onto_dyn_array(lefts, (void*)((i * 7) % 13));
+    push_onto_dyn_array(rights, (void*)((i * 5) % 17));
+  }
+
+  int res = check_all_joins(lefts, rights);
+
+  free_dyn_array(lefts);
+  free_dyn_array(rights);
+  return res;
+}
+
+int skewed_sizes() {
+  dyn_array* lefts  = init_dyn_array(UINT64);
+  dyn_array* rights = init_dyn_array(UINT64);
+  for (size_t i = 0; i < 10; i += 1) {
+    push_onto_dyn_array(lefts, (void*)(i * 97 + 1));
+  }
+  push_onto_dyn_array(lefts, (void*)(98));
+  for (size_t i = 0; i < BIG_ARRAY_SIZE; i += 1) {
+    push_onto_dyn_array(rights, (void*)(i + 1));
+    push_onto_dyn_array(rights, (void*)(i + 1));
+  }
+
+  // Exercise both argument orders of the galloping side.
+  int res = check_all_joins(lefts, rights);
+  if (res == 0) {
+    res = check_all_joins(rights, lefts);
+  }
+
+  free_dyn_array(lefts);
+  free_dyn_array(rights);
+  return res;
+}
+
+int empty_sides() {
+  dyn_array* lefts  = init_dyn_array(UINT64);
+  dyn_array* rights = init_dyn_array(UINT64);
+  push_onto_dyn_array(rights, (void*)1);
+
+  int res = check_all_joins(lefts, rights);
+
+  free_dyn_array(lefts);
+  free_dyn_array(rights);
+  return res;
+}
+
+int wide_values() {
+  dyn_array* lefts  = init_dyn_array(UINT64);
+  dyn_array* rights = init_dyn_array(UINT64);
+  // Unsorted values 2^31 and more apart, so that sorting them is only
+  // right if no comparison truncates their difference.
+  for (size_t i = 0; i < BIG_ARRAY_SIZE; i += 1) {
+    uint64_t value = ((i * 7919) % BIG_ARRAY_SIZE) << 31;
+    push_onto_dyn_array(lefts, (void*)value);
+    push_onto_dyn_array(rights, (void*)((value * 3) % ((uint64_t)1 << 40)));
+  }
+  push_onto_dyn_array(lefts, (void*)UINT64_MAX);
+  push_onto_dyn_array(rights, (void*)UINT64_MAX);
+
+  int res     = check_all_joins(lefts, rights);
+  uint64_t* l = (uint64_t*)lefts->data;
+  for (size_t i = 1; i < lefts->occupied && res == 0; i += 1) {
+    if (l[i - 1] > l[i]) {
+      res = -4;
+    }
+  }
+
+  free_dyn_array(lefts);
+  free_dyn_array(rights);
+  return res;
+}
+
+int main(int argc, char** argv) {
+  printf("Running Tests\n");
+  printf("-------------\n");
+  run_test("practice_input", practice_input);
+  run_test("duplicate_heavy", duplicate_heavy);
+  run_test("skewed_sizes", skewed_sizes);
+  run_test("empty_sides", empty_sides);
+  run_test("wide_values", wide_values);
+
+  return 0;
+}
@@ -0,0 +1,122 @@
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../include/runner.h"
+#include "../include/thread_pool.h"
+
+void run_test(char* name, int (*test)()) {
+  printf("- %s\n", name);
+  int res = test();
+  printf(" - result: %d\n", res);
+}
+
+// Write CONTENT to a fresh temporary file at PATH, a mkstemp template.
+void temporary_input(char* path, const char* content) {
+  int fd = mkstemp(path);
+  assert(write(fd, content, strlen(content)) == (ssize_t)strlen(content));
+  close(fd);
+}
+
+void add_line_lengths(void* v_lengths, size_t begin, size_t end) {
+  uint64_t* lengths = v_lengths;
+  for (size_t i = begin; i < end; i += 1) {
+    lengths[i] *= 2;
+  }
+}
+
+// Answer with the number of lines and twice the sum of their lengths,
+// doubled on the default pool to nest a loop inside the day's.
+int count_lines(FILE* input_file) {
+  uint64_t lengths[64];
+  size_t num_lines = 0;
+  char line[64];
+  while (num_lines < 64 && fgets(line, sizeof(line), input_file) != NULL) {
+    lengths[num_lines++] = strcspn(line, "\n");
+  }
+  fclose(input_file);
+
+  parallel_for(default_thread_pool(), 0, num_lines, 1, add_line_lengths,
+               lengths);
+  uint64_t sum = 0;
+  for (size_t i = 0; i < num_lines; i += 1) {
+    sum += lengths[i];
+  }
+  fprintf(current_output_file(), "Answer: %lu %lu\n", num_lines, sum);
+  return 0;
+}
+
+int fail(FILE* input_file) {
+  fclose(input_file);
+  fprintf(current_output_file(), "Failing\n");
+  return 3;
+}
+
+int days_are_ordered() {
+  size_t count;
+  const registered_day* days = registered_days(&count);
+  if (count != 2 || days[0].day != 7 || days[1].day != 12) {
+    return -1;
+  }
+  if (find_registered_day(12) != &days[1] || find_registered_day(1) != NULL) {
+    return -2;
+  }
+  if (strcmp(days[0].input_path, "day07/input.txt") != 0) {
+    return -3;
+  }
+  return 0;
+}
+
+int outputs_are_ordered() {
+  char first[]  = "/tmp/runner_test_XXXXXX";
+  char second[] = "/tmp/runner_test_XXXXXX";
+  temporary_input(first, "a\nbb\nccc\n");
+  temporary_input(second, "dddd\n");
+
+  // The same day twice, on different inputs, around a failing one.
+  day_run runs[3] = {
+      {.day = find_registered_day(12), .input_path = second},
+      {.day = find_registered_day(7), .input_path = first},
+      {.day = find_registered_day(12), .input_path = first},
+  };
+
+  int res = 0;
+  for (int repeat = 0; repeat < 2 && res == 0; repeat += 1) {
+    run_days(runs, 3);
+
+    char* written;
+    size_t length;
+    FILE* output   = open_memstream(&written, &length);
+    bool succeeded = write_day_outputs(runs, 3, output);
+    fclose(output);
+
+    if (succeeded || runs[1].status != 3) {
+      res = -1;
+    } else if (strcmp(written, "Day 12:\nAnswer: 1 8\n"
+                               "Day 07:\nFailing\n"
+                               "Day 12:\nAnswer: 3 12\n") != 0) {
+      res = -2;
+    }
+    free(written);
+  }
+
+  free_day_outputs(runs, 3);
+  unlink(first);
+  unlink(second);
+  return res;
+}
+
+int main(int argc, char** argv) {
+  register_day(12, count_lines);
+  register_day(7, fail);
+
+  printf("Running Tests\n");
+  printf("-------------\n");
+  run_test("days_are_ordered", days_are_ordered);
+  run_test("outputs_are_ordered", outputs_are_ordered);
+
+  return 0;
+}
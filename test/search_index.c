@@ -0,0 +1,150 @@
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "../include/dyn_array.h"
+#include "../include/search_index.h"
+
+#define BIG_ARRAY_SIZE 1000
+
+void run_test(char* name, int (*test)()) {
+  printf("- %s\n", name);
+  int res = test();
+  printf(" - result: %d\n", res);
+}
+
+// Check every query from just below the smallest to just above the
+// largest key of the sorted array ARR against a linear scan.
+int check_against_linear_scan(dyn_array* arr) {
+  search_index* index = init_search_index(arr);
+  uint64_t* keys      = (uint64_t*)arr->data;
+  uint64_t max_key    = arr->occupied == 0 ? 0 : keys[arr->occupied - 1];
+
+  int res = 0;
+  for (uint64_t key = 0; key <= max_key + 1; key += 1) {
+    size_t lower = 0;
+    while (lower < arr->occupied && keys[lower] < key) {
+      lower += 1;
+    }
+    size_t upper = lower;
+    while (upper < arr->occupied && keys[upper] == key) {
+      upper += 1;
+    }
+
+    size_t batched_lower;
+    size_t batched_count;
+    lower_bound_batch_in_search_index(index, &key, 1, &batched_lower);
+    count_batch_in_search_index(index, &key, 1, &batched_count);
+
+    if (lower_bound_in_search_index(index, key) != lower ||
+        upper_bound_in_search_index(index, key) != upper ||
+        count_in_search_index(index, key) != upper - lower ||
+        contains_in_search_index(index, key) != (upper > lower) ||
+        batched_lower != lower || batched_count != upper - lower) {
+      res = -1;
+      break;
+    }
+  }
+
+  free_search_index(index);
+  return res;
+}
+
+int every_size_up_to_a_hundred() {
+  for (size_t size = 0; size <= 100; size += 1) {
+    dyn_array* arr = init_dyn_array(UINT64);
+    for (size_t i = 0; i < size; i += 1) {
+      push_onto_dyn_array(arr, (void*)(2 * i + 1));
+    }
+
+    int res = check_against_linear_scan(arr);
+    free_dyn_array(arr);
+    if (res != 0) {
+      return res;
+    }
+  }
+  return 0;
+}
+
+int duplicate_keys() {
+  dyn_array* arr = init_dyn_array(UINT64);
+  for (size_t i = 0; i < BIG_ARRAY_SIZE; i += 1) {
+    push_onto_dyn_array(arr, (void*)(i / 7));
+  }
+
+  int res = check_against_linear_scan(arr);
+  free_dyn_array(arr);
+  return res;
+}
+
+int batch_matches_single_queries() {
+  dyn_array* arr = init_dyn_array(UINT64);
+  for (size_t i = 0; i < BIG_ARRAY_SIZE; i += 1) {
+    push_onto_dyn_array(arr, (void*)(3 * i));
+  }
+  search_index* index = init_search_index(arr);
+
+  // An awkward number of queries to leave a partial final batch.
+  uint64_t keys[BIG_ARRAY_SIZE + 5];
+  size_t lowers[BIG_ARRAY_SIZE + 5];
+  size_t counts[BIG_ARRAY_SIZE + 5];
+  for (size_t i = 0; i < BIG_ARRAY_SIZE + 5; i += 1) {
+    keys[i] = (i * 7919) % (3 * BIG_ARRAY_SIZE + 10);
+  }
+  lower_bound_batch_in_search_index(index, keys, BIG_ARRAY_SIZE + 5, lowers);
+  count_batch_in_search_index(index, keys, BIG_ARRAY_SIZE + 5, counts);
+
+  int res = 0;
+  for (size_t i = 0; i < BIG_ARRAY_SIZE + 5; i += 1) {
+    if (lowers[i] != lower_bound_in_search_index(index, keys[i]) ||
+        counts[i] != count_in_search_index(index, keys[i])) {
+      res = -1;
+    }
+  }
+
+  free_search_index(index);
+  free_dyn_array(arr);
+  return res;
+}
+
+int wide_keys() {
+  // Unsorted keys 2^31 and more apart, put in order by sort_dyn_array.
+  dyn_array* arr = init_dyn_array(UINT64);
+  for (size_t i = 0; i < BIG_ARRAY_SIZE; i += 1) {
+    push_onto_dyn_array(arr, (void*)(((i * 7919) % BIG_ARRAY_SIZE) << 31));
+  }
+  push_onto_dyn_array(arr, (void*)UINT64_MAX);
+  sort_dyn_array(arr);
+  search_index* index = init_search_index(arr);
+
+  int res = 0;
+  for (size_t i = 0; i < BIG_ARRAY_SIZE; i += 1) {
+    uint64_t key = (uint64_t)i << 31;
+    if (lower_bound_in_search_index(index, key) != i ||
+        upper_bound_in_search_index(index, key) != i + 1 ||
+        lower_bound_in_search_index(index, key + 1) != i + 1 ||
+        !contains_in_search_index(index, key) ||
+        contains_in_search_index(index, key + 1)) {
+      res = -1;
+      break;
+    }
+  }
+  if (lower_bound_in_search_index(index, UINT64_MAX) != BIG_ARRAY_SIZE) {
+    res = -2;
+  }
+
+  free_search_index(index);
+  free_dyn_array(arr);
+  return res;
+}
+
+int main(int argc, char** argv) {
+  printf("Running Tests\n");
+  printf("-------------\n");
+  run_test("every_size_up_to_a_hundred", every_size_up_to_a_hundred);
+  run_test("duplicate_keys", duplicate_keys);
+  run_test("batch_matches_single_queries", batch_matches_single_queries);
+  run_test("wide_keys", wide_keys);
+
+  return 0;
+}
@@ -0,0 +1,149 @@
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../include/dyn_array.h"
+#include "../include/hash_table.h"
+#include "../include/text_writer.h"
+
+void run_test(char* name, int (*test)()) {
+  printf("- %s\n", name);
+  int res = test();
+  printf(" - result: %d\n", res);
+}
+
+int integers_match_printf() {
+  int64_t values[] = {0,         1,          9,         10,        99,
+                      100,       -1,         -10,       123456789, INT64_MAX,
+                      INT64_MIN, 1000000000, -99999999};
+  size_t num_values = sizeof(values) / sizeof(int64_t);
+
+  text_writer* writer = init_string_writer();
+  char expected[1024] = "";
+  for (size_t i = 0; i < num_values; i += 1) {
+    write_int64(writer, values[i]);
+    write_char(writer, ' ');
+    sprintf(expected + strlen(expected), "%ld ", values[i]);
+  }
+  write_uint64(writer, UINT64_MAX);
+  sprintf(expected + strlen(expected), "%lu", UINT64_MAX);
+
+  char* written = finish_string_writer(writer);
+  int res       = strcmp(written, expected) == 0 ? 0 : -1;
+  free(written);
+  return res;
+}
+
+int strings_grow() {
+  text_writer* writer = init_string_writer();
+  for (int i = 0; i < 10000; i += 1) {
+    write_string(writer, "abc");
+  }
+  char* written = finish_string_writer(writer);
+
+  int res = strlen(written) == 30000 ? 0 : -1;
+  for (int i = 0; i < 30000 && res == 0; i += 3) {
+    if (memcmp(written + i, "abc", 3) != 0) {
+      res = -2;
+    }
+  }
+  free(written);
+  return res;
+}
+
+// Stream LENGTH bytes, in pieces of up to twice the buffer size,
+// through WRITER to READ_FD, and check they all come out in order.
+int check_streamed(text_writer* writer, int read_fd, size_t length) {
+  char* content = malloc(length);
+  for (size_t i = 0; i < length; i += 1) {
+    content[i] = 'a' + (i * 31) % 26;
+  }
+
+  size_t position = 0;
+  for (size_t piece = 1; position < length; piece = piece * 3 + 1) {
+    if (piece > 2 * TEXT_WRITER_BUFFER_SIZE) {
+      piece = 1;
+    }
+    size_t piece_length = piece < length - position ? piece : length - position;
+    write_text(writer, content + position, piece_length);
+    position += piece_length;
+  }
+  free_text_writer(writer);
+
+  char* read_back = malloc(length);
+  size_t got      = 0;
+  ssize_t count;
+  while (got < length &&
+         (count = pread(read_fd, read_back + got, length - got, got)) > 0) {
+    got += count;
+  }
+
+  int res = got == length && memcmp(content, read_back, length) == 0 ? 0 : -1;
+  free(content);
+  free(read_back);
+  return res;
+}
+
+int streams_to_files() {
+  size_t length = 5 * TEXT_WRITER_BUFFER_SIZE + 17;
+
+  char path[] = "/tmp/text_writer_test_XXXXXX";
+  int fd      = mkstemp(path);
+  unlink(path);
+  int res = check_streamed(init_fd_writer(fd), fd, length);
+  close(fd);
+  if (res != 0) {
+    return res;
+  }
+
+  FILE* file          = tmpfile();
+  text_writer* writer = init_file_writer(file);
+  write_text(writer, "", 0);
+  res = check_streamed(writer, fileno(file), length);
+  fclose(file);
+  return res;
+}
+
+int pretty_printers_unchanged() {
+  dyn_array* arr = init_dyn_array(UINT64);
+  char* pp       = pp_dyn_array(arr);
+  int res        = strcmp(pp, "[]") == 0 ? 0 : -1;
+  free(pp);
+
+  push_onto_dyn_array(arr, (void*)7);
+  push_onto_dyn_array(arr, (void*)UINT64_MAX);
+  dyn_array* nested = init_dyn_array(DYN_ARRAY);
+  push_onto_dyn_array(nested, arr);
+  push_onto_dyn_array(nested, arr);
+  pp  = pp_dyn_array(nested);
+  res = res == 0 && strcmp(pp, "[[7, -1], [7, -1]]") == 0 ? 0 : -2;
+  free(pp);
+
+  hash_table* table = init_hash_table(UINT64, UINT64);
+  pp                = pp_hash_table(table);
+  res               = res == 0 && strcmp(pp, "{ }") == 0 ? 0 : -3;
+  free(pp);
+  set_entry_in_hash_table(table, (void*)2, (void*)20);
+  pp  = pp_hash_table(table);
+  res = res == 0 && strcmp(pp, "{2: 20}") == 0 ? 0 : -4;
+  free(pp);
+
+  free_hash_table(table);
+  free_dyn_array(nested);
+  free_dyn_array(arr);
+  return res;
+}
+
+int main(int argc, char** argv) {
+  printf("Running Tests\n");
+  printf("-------------\n");
+  run_test("integers_match_printf", integers_match_printf);
+  run_test("strings_grow", strings_grow);
+  run_test("streams_to_files", streams_to_files);
+  run_test("pretty_printers_unchanged", pretty_printers_unchanged);
+
+  return 0;
+}
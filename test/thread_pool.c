@@ -0,0 +1,128 @@
+#include <assert.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "../include/dyn_array.h"
+#include "../include/thread_pool.h"
+
+#define BIG_ARRAY_SIZE 100000
+
+void run_test(char* name, int (*test)()) {
+  printf("- %s\n", name);
+  int res = test();
+  printf(" - result: %d\n", res);
+}
+
+void mark_range(void* context, size_t begin, size_t end) {
+  atomic_uint* visits = context;
+  for (size_t i = begin; i < end; i += 1) {
+    atomic_fetch_add(&visits[i], 1);
+  }
+}
+
+int every_index_visited_once() {
+  static atomic_uint visits[BIG_ARRAY_SIZE];
+  for (size_t i = 0; i < BIG_ARRAY_SIZE; i += 1) {
+    atomic_init(&visits[i], 0);
+  }
+
+  thread_pool* pool = init_thread_pool(4);
+  parallel_for(pool, 0, BIG_ARRAY_SIZE, 7, mark_range, visits);
+  free_thread_pool(pool);
+
+  for (size_t i = 0; i < BIG_ARRAY_SIZE; i += 1) {
+    if (atomic_load(&visits[i]) != 1) {
+      return -1;
+    }
+  }
+  return 0;
+}
+
+// A partial result which records the order it was folded in.
+void fingerprint_range(void* context, size_t begin, size_t end,
+                       void* partial) {
+  uint64_t sum = 0;
+  for (size_t i = begin; i < end; i += 1) {
+    sum += i;
+  }
+  *(uint64_t*)partial = sum;
+}
+
+void fold_fingerprints(void* result, const void* partial) {
+  uint64_t* acc = result;
+  *acc          = *acc * 1099511628211UL + *(const uint64_t*)partial;
+}
+
+int reduce_is_deterministic() {
+  uint64_t expected = 0;
+  for (size_t workers = 0; workers <= 8; workers += 1) {
+    thread_pool* pool = init_thread_pool(workers);
+    uint64_t result   = 0;
+    parallel_reduce(pool, 3, BIG_ARRAY_SIZE, 1000, &result, sizeof(uint64_t),
+                    fingerprint_range, fold_fingerprints, NULL);
+    free_thread_pool(pool);
+
+    if (workers == 0) {
+      expected = result;
+    } else if (result != expected) {
+      return -1;
+    }
+  }
+  return 0;
+}
+
+void sum_elements(void* context, dyn_array* arr, size_t begin, size_t end,
+                  void* partial) {
+  uint64_t sum = 0;
+  for (size_t i = begin; i < end; i += 1) {
+    sum += (uint64_t)get_element_of_dyn_array(arr, i);
+  }
+  *(uint64_t*)partial = sum;
+}
+
+void add_sums(void* result, const void* partial) {
+  *(uint64_t*)result += *(const uint64_t*)partial;
+}
+
+void nested_sums(void* context, size_t begin, size_t end) {
+  dyn_array* arr    = context;
+  thread_pool* pool = default_thread_pool();
+  for (size_t i = begin; i < end; i += 1) {
+    uint64_t sum = 0;
+    parallel_reduce_dyn_array(pool, arr, 100, &sum, sizeof(uint64_t),
+                              sum_elements, add_sums, NULL);
+    assert(sum == (uint64_t)(arr->occupied - 1) * arr->occupied / 2);
+  }
+}
+
+int nested_loops_on_one_pool() {
+  dyn_array* arr = init_dyn_array(UINT64);
+  for (size_t i = 0; i < 10000; i += 1) {
+    push_onto_dyn_array(arr, (void*)i);
+  }
+
+  // Loops started from inside the pool's own tasks must still finish.
+  parallel_for(default_thread_pool(), 0, 64, 1, nested_sums, arr);
+
+  free_dyn_array(arr);
+  return 0;
+}
+
+int empty_ranges() {
+  uint64_t result = 42;
+  parallel_reduce(default_thread_pool(), 5, 5, 1, &result, sizeof(uint64_t),
+                  fingerprint_range, fold_fingerprints, NULL);
+  return result == 42 ? 0 : -1;
+}
+
+int main(int argc, char** argv) {
+  printf("Running Tests\n");
+  printf("-------------\n");
+  run_test("every_index_visited_once", every_index_visited_once);
+  run_test("reduce_is_deterministic", reduce_is_deterministic);
+  run_test("nested_loops_on_one_pool", nested_loops_on_one_pool);
+  run_test("empty_ranges", empty_ranges);
+
+  return 0;
+}
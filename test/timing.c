@@ -0,0 +1,78 @@
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/perf_counters.h"
+#include "../include/timing.h"
+
+#define JSON_PATH "test-timing.json"
+
+void run_test(char* name, int (*test)()) {
+  printf("- %s\n", name);
+  int res = test();
+  printf(" - result: %d\n", res);
+}
+
+int nested_phases_as_json() {
+  begin_phase("outer");
+  begin_phase("inner");
+  volatile uint64_t sum = 0;
+  for (uint64_t i = 0; i < 1000000; i += 1) {
+    sum += i;
+  }
+  end_phase();
+  end_phase();
+  flush_phase_timings();
+
+  FILE* json = fopen(JSON_PATH, "r");
+  if (json == NULL) {
+    return -1;
+  }
+  char buffer[1024];
+  size_t length  = fread(buffer, 1, sizeof(buffer) - 1, json);
+  buffer[length] = '\0';
+  fclose(json);
+  remove(JSON_PATH);
+
+  // Inner phases end, and so are written, first.
+  char* inner = strstr(buffer, "\"phase\": \"outer/inner\", \"depth\": 1");
+  char* outer = strstr(buffer, "\"phase\": \"outer\", \"depth\": 0");
+  return inner != NULL && outer != NULL && inner < outer ? 0 : -1;
+}
+
+int perf_counters_fall_back() {
+  // Whichever counters this system permits, readings are consistent.
+  perf_reading before;
+  perf_reading after;
+  read_perf_counters(&before);
+  volatile uint64_t sum = 0;
+  for (uint64_t i = 0; i < 1000000; i += 1) {
+    sum += i;
+  }
+  read_perf_counters(&after);
+
+  perf_reading between = perf_counters_between(&before, &after);
+  if (between.available != before.available) {
+    return -1;
+  }
+  if ((between.available & (1u << PERF_INSTRUCTIONS)) &&
+      between.values[PERF_INSTRUCTIONS] < 1000000) {
+    return -1;
+  }
+  return 0;
+}
+
+int main(int argc, char** argv) {
+  // Timing is configured once, on first use.
+  setenv("AOC_TIMING", JSON_PATH, 1);
+  assert(timing_enabled());
+
+  printf("Running Tests\n");
+  printf("-------------\n");
+  run_test("nested_phases_as_json", nested_phases_as_json);
+  run_test("perf_counters_fall_back", perf_counters_fall_back);
+
+  return 0;
+}
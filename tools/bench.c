@@ -0,0 +1,382 @@
+/*
+  End-to-end benchmark harness for the solutions.
+
+  Runs a solution binary on an input and on copies of it scaled up by
+  repetition, discarding some warm-up runs, and reports the min, median
+  and 95th percentile wall time of the rest along with throughput in
+  lines and MB per second. Results can be saved, and compared against
+  those saved by an earlier run - exiting non-zero, without saving, if
+  any median got slower by more than a threshold.
+
+  Usage: bench-harness SOLUTION INPUT [-w WARMUPS] [-n REPEATS]
+                       [-s SCALE,...] [-o SAVE_FILE] [-c BASELINE_FILE]
+                       [-t THRESHOLD_PERCENT] [-l LABEL]
+
+  Results are matched to the baseline's by label, which defaults to the
+  solution's file name and the input - so giving two builds of a
+  solution the same label compares one against the other.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+// Scaled copies of inputs are kept here between runs.
+#define SCALED_INPUT_DIR "bench-inputs"
+
+#define MAX_SCALES 16
+#define MAX_NAME 256
+
+typedef struct {
+  const char* solution;
+  const char* input;
+  int warmups;
+  int repeats;
+  uint64_t scales[MAX_SCALES];
+  int num_scales;
+  const char* save_path;
+  const char* baseline_path;
+  double threshold; // Percent a median may grow before it is flagged.
+  const char* label;
+} bench_options;
+
+typedef struct {
+  char name[MAX_NAME]; // Label, e.g. solution-01:day01/input.txt.
+  uint64_t scale;
+  uint64_t min_ns;
+  uint64_t median_ns;
+  uint64_t p95_ns;
+} bench_result;
+
+static uint64_t monotonic_ns() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+static const char* base_name(const char* path) {
+  const char* slash = strrchr(path, '/');
+  return slash == NULL ? path : slash + 1;
+}
+
+// Count the lines and bytes of the file at PATH.
+static bool measure_input(const char* path, uint64_t* lines,
+                          uint64_t* bytes) {
+  FILE* file = fopen(path, "r");
+  if (file == NULL) {
+    perror(path);
+    return false;
+  }
+
+  char buffer[1 << 16];
+  size_t got;
+  *lines = 0;
+  *bytes = 0;
+  while ((got = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+    *bytes += got;
+    for (size_t i = 0; i < got; i += 1) {
+      *lines += buffer[i] == '\n';
+    }
+  }
+  fclose(file);
+  return true;
+}
+
+// Write INPUT repeated SCALE times to a file under SCALED_INPUT_DIR,
+// unless one is already there, and put its path into PATH.
+static bool scaled_input(const char* input, uint64_t scale, char* path,
+                         size_t path_size) {
+  if (scale == 1) {
+    snprintf(path, path_size, "%s", input);
+    return true;
+  }
+
+  // Inputs of different days share base names, so the directory is
+  // part of the name.
+  char flattened[MAX_NAME];
+  snprintf(flattened, sizeof(flattened), "%s", input);
+  for (char* c = flattened; *c != '\0'; c += 1) {
+    if (*c == '/') {
+      *c = '_';
+    }
+  }
+  mkdir(SCALED_INPUT_DIR, 0755);
+  snprintf(path, path_size, "%s/%s.x%lu", SCALED_INPUT_DIR, flattened, scale);
+
+  struct stat original;
+  struct stat scaled;
+  if (stat(input, &original) != 0) {
+    perror(input);
+    return false;
+  }
+  if (stat(path, &scaled) == 0 &&
+      (uint64_t)scaled.st_size == scale * original.st_size &&
+      scaled.st_mtime >= original.st_mtime) {
+    return true;
+  }
+
+  FILE* in = fopen(input, "r");
+  if (in == NULL) {
+    perror(input);
+    return false;
+  }
+  char* contents = malloc(original.st_size + 1);
+  size_t length  = fread(contents, 1, original.st_size, in);
+  fclose(in);
+
+  // A final line without its newline would run into the next copy.
+  if (length > 0 && contents[length - 1] != '\n') {
+    fprintf(stderr, "%s does not end in a newline, cannot be scaled\n",
+            input);
+    free(contents);
+    return false;
+  }
+
+  FILE* out = fopen(path, "w");
+  if (out == NULL) {
+    perror(path);
+    free(contents);
+    return false;
+  }
+  for (uint64_t i = 0; i < scale; i += 1) {
+    fwrite(contents, 1, length, out);
+  }
+  fclose(out);
+  free(contents);
+  return true;
+}
+
+// Run SOLUTION on INPUT with its output discarded - return the wall
+// time taken, or 0 if it failed.
+static uint64_t time_run(const char* solution, const char* input) {
+  uint64_t start = monotonic_ns();
+  pid_t pid      = fork();
+  if (pid == 0) {
+    int null = open("/dev/null", O_WRONLY);
+    dup2(null, STDOUT_FILENO);
+    execl(solution, solution, input, (char*)NULL);
+    perror(solution);
+    _exit(127);
+  }
+
+  int status;
+  waitpid(pid, &status, 0);
+  uint64_t elapsed = monotonic_ns() - start;
+  if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+    fprintf(stderr, "%s %s failed\n", solution, input);
+    return 0;
+  }
+  return elapsed;
+}
+
+static int compare_uint64(const void* a, const void* b) {
+  uint64_t x = *(const uint64_t*)a;
+  uint64_t y = *(const uint64_t*)b;
+  return (x > y) - (x < y);
+}
+
+// Benchmark OPTIONS' solution on its input scaled by SCALE into RESULT
+// - return whether every run succeeded.
+static bool bench_scale(bench_options* options, uint64_t scale,
+                        bench_result* result) {
+  char input[MAX_NAME + 64];
+  if (!scaled_input(options->input, scale, input, sizeof(input))) {
+    return false;
+  }
+  uint64_t lines;
+  uint64_t bytes;
+  if (!measure_input(input, &lines, &bytes)) {
+    return false;
+  }
+
+  for (int i = 0; i < options->warmups; i += 1) {
+    if (time_run(options->solution, input) == 0) {
+      return false;
+    }
+  }
+
+  uint64_t* times = malloc(options->repeats * sizeof(uint64_t));
+  for (int i = 0; i < options->repeats; i += 1) {
+    times[i] = time_run(options->solution, input);
+    if (times[i] == 0) {
+      free(times);
+      return false;
+    }
+  }
+  qsort(times, options->repeats, sizeof(uint64_t), compare_uint64);
+
+  if (options->label != NULL) {
+    snprintf(result->name, sizeof(result->name), "%s", options->label);
+  } else {
+    snprintf(result->name, sizeof(result->name), "%s:%s",
+             base_name(options->solution), options->input);
+  }
+  result->scale     = scale;
+  result->min_ns    = times[0];
+  result->median_ns = times[options->repeats / 2];
+  // Nearest rank.
+  result->p95_ns = times[(options->repeats * 95 + 99) / 100 - 1];
+  free(times);
+
+  double median_s = result->median_ns / 1e9;
+  printf("%-36s x%-8lu %10.3f %10.3f %10.3f %14.0f %10.1f\n", result->name,
+         scale, result->min_ns / 1e6, result->median_ns / 1e6,
+         result->p95_ns / 1e6, lines / median_s, bytes / median_s / 1e6);
+  return true;
+}
+
+// Compare RESULTS (NUM_RESULTS long) against those saved at
+// BASELINE_PATH - return how many regressed by more than THRESHOLD
+// percent.
+static int compare_to_baseline(bench_result* results, int num_results,
+                               const char* baseline_path, double threshold) {
+  FILE* file = fopen(baseline_path, "r");
+  if (file == NULL) {
+    printf("no baseline at %s to compare against\n", baseline_path);
+    return 0;
+  }
+
+  int regressions = 0;
+  bench_result old;
+  while (fscanf(file, "%255s %lu %lu %lu %lu", old.name, &old.scale,
+                &old.min_ns, &old.median_ns, &old.p95_ns) == 5) {
+    for (int i = 0; i < num_results; i += 1) {
+      bench_result* new = &results[i];
+      if (strcmp(new->name, old.name) != 0 || new->scale != old.scale) {
+        continue;
+      }
+
+      double change =
+          100.0 * ((double)new->median_ns - old.median_ns) / old.median_ns;
+      bool regressed = change > threshold;
+      printf("%-36s x%-8lu median %10.3f -> %10.3f ms (%+6.1f%%)%s\n",
+             new->name, new->scale, old.median_ns / 1e6,
+             new->median_ns / 1e6, change, regressed ? "  REGRESSION" : "");
+      regressions += regressed;
+    }
+  }
+  fclose(file);
+  return regressions;
+}
+
+static bool save_results(bench_result* results, int num_results,
+                         const char* save_path) {
+  FILE* file = fopen(save_path, "w");
+  if (file == NULL) {
+    perror(save_path);
+    return false;
+  }
+  for (int i = 0; i < num_results; i += 1) {
+    fprintf(file, "%s %lu %lu %lu %lu\n", results[i].name, results[i].scale,
+            results[i].min_ns, results[i].median_ns, results[i].p95_ns);
+  }
+  fclose(file);
+  return true;
+}
+
+static bool parse_scales(char* list, bench_options* options) {
+  options->num_scales = 0;
+  for (char* scale = strtok(list, ","); scale != NULL;
+       scale       = strtok(NULL, ",")) {
+    if (options->num_scales == MAX_SCALES) {
+      return false;
+    }
+    options->scales[options->num_scales] = strtoull(scale, NULL, 10);
+    if (options->scales[options->num_scales] == 0) {
+      return false;
+    }
+    options->num_scales += 1;
+  }
+  return options->num_scales > 0;
+}
+
+static void usage(const char* program) {
+  fprintf(stderr,
+          "usage: %s SOLUTION INPUT [-w WARMUPS] [-n REPEATS] "
+          "[-s SCALE,...] [-o SAVE_FILE] [-c BASELINE_FILE] "
+          "[-t THRESHOLD_PERCENT] [-l LABEL]\n",
+          program);
+  exit(2);
+}
+
+int main(int argc, char** argv) {
+  bench_options options = {.warmups    = 2,
+                           .repeats    = 10,
+                           .scales     = {1},
+                           .num_scales = 1,
+                           .threshold  = 5};
+
+  int opt;
+  while ((opt = getopt(argc, argv, "w:n:s:o:c:t:l:")) != -1) {
+    switch (opt) {
+    case 'w':
+      options.warmups = atoi(optarg);
+      break;
+    case 'n':
+      options.repeats = atoi(optarg);
+      break;
+    case 's':
+      if (!parse_scales(optarg, &options)) {
+        usage(argv[0]);
+      }
+      break;
+    case 'o':
+      options.save_path = optarg;
+      break;
+    case 'c':
+      options.baseline_path = optarg;
+      break;
+    case 't':
+      options.threshold = atof(optarg);
+      break;
+    case 'l':
+      if (strchr(optarg, ' ') != NULL) {
+        usage(argv[0]);
+      }
+      options.label = optarg;
+      break;
+    default:
+      usage(argv[0]);
+    }
+  }
+  if (argc - optind != 2 || options.warmups < 0 || options.repeats < 1) {
+    usage(argv[0]);
+  }
+  options.solution = argv[optind];
+  options.input    = argv[optind + 1];
+
+  printf("%-36s %-9s %10s %10s %10s %14s %10s\n", "benchmark", "scale",
+         "min ms", "median ms", "p95 ms", "lines/s", "MB/s");
+  bench_result results[MAX_SCALES];
+  for (int i = 0; i < options.num_scales; i += 1) {
+    if (!bench_scale(&options, options.scales[i], &results[i])) {
+      return 1;
+    }
+  }
+
+  // Compare before saving, so a run can replace its own baseline.
+  int regressions = 0;
+  if (options.baseline_path != NULL) {
+    regressions = compare_to_baseline(results, options.num_scales,
+                                      options.baseline_path, options.threshold);
+  }
+  if (regressions > 0) {
+    // Keep the baseline which was beaten.
+    printf("%d regression(s) over %.1f%%, results not saved\n", regressions,
+           options.threshold);
+    return 1;
+  }
+  if (options.save_path != NULL &&
+      !save_results(results, options.num_scales, options.save_path)) {
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,429 @@
+/*
+  Deterministic generator of synthetic inputs in the day 01 and day 02
+  formats, of any size - output is streamed, so tens of GB take no more
+  memory than a thousand lines.
+
+  Usage: generate-input DAY [options] > input.txt
+
+    -n LINES        Number of lines (default 1000).
+    -s SEED         Seed - the same seed and options give the same file.
+
+  Day 01, pairs of "LEFT   RIGHT":
+    -r MIN,MAX      Range of values (default 10000,99999). MAX times
+                    LINES squared has to fit in a signed 64-bit
+                    integer, as part 2 may sum up to LINES matches of
+                    each of LINES values - and answers are printed
+                    signed.
+    -z EXPONENT     Zipf skew of values over their range - 0 (default)
+                    for uniform, around 1 for a few very hot values.
+    -d RATE         Fraction of right values copying a recent left value,
+                    so that part 2 finds matches (default 0.1).
+
+  Day 02, reports of levels:
+    -l MIN,MAX      Range of report lengths in levels (default 5,8).
+    -f FRACTION     Fraction of reports which are safe (default 0.5).
+    -a FRACTION     Fraction which are only safe with one level
+                    removed (default 0.2). The rest are unsafe either way.
+    -e              Print the answers the file should give to stderr.
+ */
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Number of recent left values right values may copy.
+#define RECENT_LEFTS 1024
+
+// Longest report generated.
+#define MAX_REPORT_LENGTH 64
+
+typedef struct {
+  uint64_t state[4];
+} rng;
+
+typedef struct {
+  uint64_t lines;
+  uint64_t seed;
+  uint64_t min_value;
+  uint64_t max_value;
+  double zipf_exponent;
+  double duplicate_rate;
+  unsigned min_length;
+  unsigned max_length;
+  double safe_fraction;
+  double almost_safe_fraction;
+  bool print_answers;
+} generate_options;
+
+//// Random numbers.
+
+static uint64_t splitmix64(uint64_t* x) {
+  uint64_t z = (*x += 0x9e3779b97f4a7c15UL);
+  z          = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9UL;
+  z          = (z ^ (z >> 27)) * 0x94d049bb133111ebUL;
+  return z ^ (z >> 31);
+}
+
+static void seed_rng(rng* r, uint64_t seed) {
+  for (int i = 0; i < 4; i += 1) {
+    r->state[i] = splitmix64(&seed);
+  }
+}
+
+static uint64_t rotl(uint64_t x, int k) {
+  return (x << k) | (x >> (64 - k));
+}
+
+// xoshiro256**.
+static uint64_t next_uint64(rng* r) {
+  uint64_t* s     = r->state;
+  uint64_t result = rotl(s[1] * 5, 7) * 9;
+  uint64_t t      = s[1] << 17;
+  s[2] ^= s[0];
+  s[3] ^= s[1];
+  s[1] ^= s[2];
+  s[0] ^= s[3];
+  s[2] ^= t;
+  s[3] = rotl(s[3], 45);
+  return result;
+}
+
+// Return a uniform double in [0, 1).
+static double next_double(rng* r) {
+  return (next_uint64(r) >> 11) * 0x1.0p-53;
+}
+
+// Return a uniform integer in [0, BOUND).
+static uint64_t next_below(rng* r, uint64_t bound) {
+  return (uint64_t)(((unsigned __int128)next_uint64(r) * bound) >> 64);
+}
+
+//// Zipf-distributed ranks, by rejection-inversion (Hörmann and
+//// Derflinger 1996) - constant time per sample for any number of ranks.
+
+typedef struct {
+  double exponent;
+  uint64_t num_ranks;
+  double h_integral_x1;
+  double h_integral_n;
+  double s;
+} zipf_sampler;
+
+// (exp(x) - 1) / x, accurate near 0.
+static double helper_expm1(double x) {
+  return fabs(x) > 1e-8 ? expm1(x) / x : 1 + x / 2 * (1 + x / 3);
+}
+
+// log(1 + x) / x, accurate near 0.
+static double helper_log1p(double x) {
+  return fabs(x) > 1e-8 ? log1p(x) / x : 1 - x * (0.5 - x / 3);
+}
+
+static double h_integral(zipf_sampler* z, double x) {
+  double log_x = log(x);
+  return helper_expm1((1 - z->exponent) * log_x) * log_x;
+}
+
+static double h(zipf_sampler* z, double x) {
+  return exp(-z->exponent * log(x));
+}
+
+static double h_integral_inverse(zipf_sampler* z, double x) {
+  double t = x * (1 - z->exponent);
+  if (t < -1) {
+    t = -1;
+  }
+  return exp(helper_log1p(t) * x);
+}
+
+static void init_zipf_sampler(zipf_sampler* z, uint64_t num_ranks,
+                              double exponent) {
+  z->exponent      = exponent;
+  z->num_ranks     = num_ranks;
+  z->h_integral_x1 = h_integral(z, 1.5) - 1;
+  z->h_integral_n  = h_integral(z, num_ranks + 0.5);
+  z->s             = 2 - h_integral_inverse(z, h_integral(z, 2.5) - h(z, 2));
+}
+
+// Return a rank in [1, NUM_RANKS], rank k having weight k^-EXPONENT.
+static uint64_t next_zipf(zipf_sampler* z, rng* r) {
+  while (true) {
+    double u = z->h_integral_n +
+               next_double(r) * (z->h_integral_x1 - z->h_integral_n);
+    double x = h_integral_inverse(z, u);
+    double k = floor(x + 0.5);
+    if (k < 1) {
+      k = 1;
+    } else if (k > z->num_ranks) {
+      k = z->num_ranks;
+    }
+    if (k - x <= z->s || u >= h_integral(z, k + 0.5) - h(z, k)) {
+      return (uint64_t)k;
+    }
+  }
+}
+
+//// Output.
+
+static char out_buffer[1 << 20];
+static size_t out_length = 0;
+
+static void flush_out() {
+  fwrite(out_buffer, 1, out_length, stdout);
+  out_length = 0;
+}
+
+static void put_char(char c) {
+  if (out_length == sizeof(out_buffer)) {
+    flush_out();
+  }
+  out_buffer[out_length++] = c;
+}
+
+static void put_uint64(uint64_t v) {
+  char digits[20];
+  int n = 0;
+  do {
+    digits[n++] = '0' + v % 10;
+    v /= 10;
+  } while (v > 0);
+  while (n > 0) {
+    put_char(digits[--n]);
+  }
+}
+
+//// Day 01.
+
+// Return the greatest common divisor of A and B.
+static uint64_t gcd(uint64_t a, uint64_t b) {
+  while (b != 0) {
+    uint64_t t = a % b;
+    a          = b;
+    b          = t;
+  }
+  return a;
+}
+
+static void generate_day01(generate_options* options, rng* r) {
+  uint64_t range = options->max_value - options->min_value + 1;
+
+  // Zipf ranks are spread over the range by a fixed stride coprime to
+  // it, so the hottest values are not all the smallest.
+  uint64_t stride = 7919;
+  while (gcd(stride, range) != 1) {
+    stride += 2;
+  }
+  zipf_sampler zipf;
+  init_zipf_sampler(&zipf, range, options->zipf_exponent);
+
+  uint64_t recent[RECENT_LEFTS];
+  uint64_t num_recent = 0;
+
+  for (uint64_t line = 0; line < options->lines; line += 1) {
+    uint64_t values[2];
+    for (int column = 0; column < 2; column += 1) {
+      if (column == 1 && num_recent > 0 &&
+          next_double(r) < options->duplicate_rate) {
+        uint64_t held  = num_recent < RECENT_LEFTS ? num_recent : RECENT_LEFTS;
+        values[column] = recent[next_below(r, held)];
+        continue;
+      }
+
+      uint64_t rank;
+      if (options->zipf_exponent > 0) {
+        rank = next_zipf(&zipf, r) - 1;
+      } else {
+        rank = next_below(r, range);
+      }
+      values[column] =
+          options->min_value +
+          (uint64_t)(((unsigned __int128)rank * stride) % range);
+    }
+    recent[num_recent++ % RECENT_LEFTS] = values[0];
+
+    put_uint64(values[0]);
+    put_char(' ');
+    put_char(' ');
+    put_char(' ');
+    put_uint64(values[1]);
+    put_char('\n');
+  }
+}
+
+//// Day 02.
+
+// Fill LEVELS with a safe report of LENGTH levels.
+static void safe_report(rng* r, uint64_t* levels, unsigned length) {
+  bool rising = next_below(r, 2) == 0;
+  // Leave room to fall by up to 3 per level without reaching 0.
+  levels[0] = rising ? 1 + next_below(r, 20) : 3 * length + next_below(r, 20);
+  for (unsigned i = 1; i < length; i += 1) {
+    uint64_t step = 1 + next_below(r, 3);
+    levels[i]     = rising ? levels[i - 1] + step : levels[i - 1] - step;
+  }
+}
+
+static void generate_day02(generate_options* options, rng* r) {
+  uint64_t levels[MAX_REPORT_LENGTH + 1];
+  uint64_t num_safe        = 0;
+  uint64_t num_almost_safe = 0;
+
+  for (uint64_t line = 0; line < options->lines; line += 1) {
+    unsigned length =
+        options->min_length +
+        next_below(r, options->max_length - options->min_length + 1);
+    double kind = next_double(r);
+
+    if (kind < options->safe_fraction) {
+      safe_report(r, levels, length);
+      num_safe += 1;
+    } else if (kind < options->safe_fraction + options->almost_safe_fraction) {
+      // A safe report with a repeat of one level inserted - removing it
+      // makes the report safe again.
+      safe_report(r, levels, length - 1);
+      unsigned at = next_below(r, length - 1);
+      memmove(&levels[at + 1], &levels[at],
+              (length - 1 - at) * sizeof(uint64_t));
+      num_almost_safe += 1;
+    } else {
+      // Two repeats apart from each other - removing one level can
+      // only undo one of them.
+      safe_report(r, levels, length);
+      unsigned first     = next_below(r, length - 3);
+      unsigned second    = first + 2 + next_below(r, length - 3 - first);
+      levels[first + 1]  = levels[first];
+      levels[second + 1] = levels[second];
+    }
+
+    for (unsigned i = 0; i < length; i += 1) {
+      if (i > 0) {
+        put_char(' ');
+      }
+      put_uint64(levels[i]);
+    }
+    put_char('\n');
+  }
+
+  if (options->print_answers) {
+    fprintf(stderr, "Answer 1: %lu\nAnswer 2: %lu\n", num_safe,
+            num_safe + num_almost_safe);
+  }
+}
+
+static bool parse_pair(const char* arg, uint64_t* first, uint64_t* second) {
+  char* end;
+  *first = strtoull(arg, &end, 10);
+  if (*end != ',') {
+    return false;
+  }
+  *second = strtoull(end + 1, &end, 10);
+  return *end == '\0' && *first <= *second;
+}
+
+static void usage(const char* program) {
+  fprintf(stderr,
+          "usage: %s DAY [-n LINES] [-s SEED] [-r MIN,MAX] [-z EXPONENT] "
+          "[-d RATE] [-l MIN,MAX] [-f FRACTION] [-a FRACTION] [-e]\n",
+          program);
+  exit(2);
+}
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    usage(argv[0]);
+  }
+  int day = atoi(argv[1]);
+
+  generate_options options = {.lines                = 1000,
+                              .seed                 = 1,
+                              .min_value            = 10000,
+                              .max_value            = 99999,
+                              .zipf_exponent        = 0,
+                              .duplicate_rate       = 0.1,
+                              .min_length           = 5,
+                              .max_length           = 8,
+                              .safe_fraction        = 0.5,
+                              .almost_safe_fraction = 0.2,
+                              .print_answers        = false};
+
+  uint64_t min_length;
+  uint64_t max_length;
+  int opt;
+  optind = 2;
+  while ((opt = getopt(argc, argv, "n:s:r:z:d:l:f:a:e")) != -1) {
+    switch (opt) {
+    case 'n':
+      options.lines = strtoull(optarg, NULL, 10);
+      break;
+    case 's':
+      options.seed = strtoull(optarg, NULL, 10);
+      break;
+    case 'r':
+      if (!parse_pair(optarg, &options.min_value, &options.max_value) ||
+          options.min_value == 0) {
+        usage(argv[0]);
+      }
+      break;
+    case 'z':
+      options.zipf_exponent = atof(optarg);
+      break;
+    case 'd':
+      options.duplicate_rate = atof(optarg);
+      break;
+    case 'l':
+      if (!parse_pair(optarg, &min_length, &max_length) || min_length < 4 ||
+          max_length > MAX_REPORT_LENGTH) {
+        // Unsafe reports need room for two separate faults.
+        fprintf(stderr, "report lengths must be within [4, %d]\n",
+                MAX_REPORT_LENGTH);
+        usage(argv[0]);
+      }
+      options.min_length = min_length;
+      options.max_length = max_length;
+      break;
+    case 'f':
+      options.safe_fraction = atof(optarg);
+      break;
+    case 'a':
+      options.almost_safe_fraction = atof(optarg);
+      break;
+    case 'e':
+      options.print_answers = true;
+      break;
+    default:
+      usage(argv[0]);
+    }
+  }
+  if (optind != argc || options.zipf_exponent < 0 ||
+      options.safe_fraction + options.almost_safe_fraction > 1) {
+    usage(argv[0]);
+  }
+
+  // Part 1 sums at most LINES distances of up to MAX, part 2 at most
+  // LINES times LINES matches of up to MAX. Checked in two steps, so
+  // the product cannot overflow even 128 bits.
+  unsigned __int128 worst_distance =
+      (unsigned __int128)options.max_value * options.lines;
+  if (day == 1 && (worst_distance > INT64_MAX ||
+                   worst_distance * options.lines > INT64_MAX)) {
+    fprintf(stderr, "values up to %lu over %lu lines overflow the answers\n",
+            options.max_value, options.lines);
+    usage(argv[0]);
+  }
+
+  rng r;
+  seed_rng(&r, options.seed);
+  if (day == 1) {
+    generate_day01(&options, &r);
+  } else if (day == 2) {
+    generate_day02(&options, &r);
+  } else {
+    usage(argv[0]);
+  }
+  flush_out();
+  return 0;
+}
@@ -0,0 +1,133 @@
+/*
+  Runs any set of the registered days in one process - concurrently,
+  with their answers written out in the order the days were given, and
+  their wall times on stderr.
+
+  Usage: runner [-r REPEATS] [all | DAY[=INPUT] ...]
+
+  Days run on their own input, dayDD/input.txt, unless given another.
+  With no days, all of them run. With REPEATS, the whole set is run
+  that many times over; the answers are written once, and the fastest
+  and median time of each day are reported.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../include/runner.h"
+
+#define MAX_RUNS 64
+
+static uint64_t monotonic_ns() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+static int compare_ns(const void* a, const void* b) {
+  uint64_t x = *(const uint64_t*)a;
+  uint64_t y = *(const uint64_t*)b;
+  return (x > y) - (x < y);
+}
+
+static void usage() {
+  fprintf(stderr, "Usage: runner [-r REPEATS] [all | DAY[=INPUT] ...]\n");
+  exit(2);
+}
+
+// Add the runs of the days named by ARG to RUNS.
+static void parse_day(char* arg, day_run* runs, size_t* num_runs) {
+  size_t count;
+  const registered_day* days = registered_days(&count);
+
+  if (strcmp(arg, "all") == 0) {
+    for (size_t i = 0; i < count && *num_runs < MAX_RUNS; i += 1) {
+      runs[*num_runs] = (day_run){.day = &days[i]};
+      *num_runs += 1;
+    }
+    return;
+  }
+
+  char* input = strchr(arg, '=');
+  if (input != NULL) {
+    *input = '\0';
+    input += 1;
+  }
+  char* end;
+  long day = strtol(arg, &end, 10);
+  if (end == arg || *end != '\0') {
+    usage();
+  }
+  const registered_day* registered = find_registered_day(day);
+  if (registered == NULL) {
+    fprintf(stderr, "Day %ld has no registered solution.\n", day);
+    exit(2);
+  }
+  if (*num_runs == MAX_RUNS) {
+    fprintf(stderr, "At most %d days can be run at once.\n", MAX_RUNS);
+    exit(2);
+  }
+  runs[*num_runs] = (day_run){.day = registered, .input_path = input};
+  *num_runs += 1;
+}
+
+int main(int argc, char** argv) {
+  day_run runs[MAX_RUNS];
+  size_t num_runs = 0;
+  long repeats    = 1;
+
+  for (int i = 1; i < argc; i += 1) {
+    if (strcmp(argv[i], "-r") == 0) {
+      if (i + 1 == argc || (repeats = atol(argv[++i])) < 1) {
+        usage();
+      }
+    } else {
+      parse_day(argv[i], runs, &num_runs);
+    }
+  }
+  if (num_runs == 0) {
+    parse_day("all", runs, &num_runs);
+  }
+  for (size_t i = 0; i < num_runs; i += 1) {
+    if (runs[i].input_path == NULL) {
+      runs[i].input_path = (char*)runs[i].day->input_path;
+    }
+  }
+
+  uint64_t* day_ns   = malloc(num_runs * repeats * sizeof(uint64_t));
+  uint64_t* total_ns = malloc(repeats * sizeof(uint64_t));
+  bool succeeded     = true;
+  for (long r = 0; r < repeats; r += 1) {
+    uint64_t start = monotonic_ns();
+    run_days(runs, num_runs);
+    total_ns[r] = monotonic_ns() - start;
+
+    for (size_t i = 0; i < num_runs; i += 1) {
+      day_ns[i * repeats + r] = runs[i].wall_ns;
+    }
+    if (r == 0) {
+      succeeded = write_day_outputs(runs, num_runs, stdout);
+      fflush(stdout);
+    }
+  }
+
+  for (size_t i = 0; i < num_runs; i += 1) {
+    uint64_t* ns = &day_ns[i * repeats];
+    qsort(ns, repeats, sizeof(uint64_t), compare_ns);
+    fprintf(stderr, "day %02d: min %10.3f ms, median %10.3f ms (%s)\n",
+            runs[i].day->day, ns[0] / 1e6, ns[repeats / 2] / 1e6,
+            runs[i].input_path);
+  }
+  qsort(total_ns, repeats, sizeof(uint64_t), compare_ns);
+  fprintf(stderr, "all:    min %10.3f ms, median %10.3f ms\n",
+          total_ns[0] / 1e6, total_ns[repeats / 2] / 1e6);
+
+  free_day_outputs(runs, num_runs);
+  free(day_ns);
+  free(total_ns);
+  return succeeded ? 0 : 1;
+}